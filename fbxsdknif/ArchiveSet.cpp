@@ -0,0 +1,109 @@
+#include "ArchiveSet.h"
+
+namespace fbxnif {
+	ArchiveSet::ArchiveSet() = default;
+
+	ArchiveSet::~ArchiveSet() = default;
+
+	void ArchiveSet::setArchives(const std::string &list) {
+		if (list == m_list)
+			return;
+
+		std::vector<std::shared_ptr<const BethesdaArchive>> archives;
+
+		size_t start = 0;
+		while (start <= list.size()) {
+			auto end = list.find(';', start);
+			if (end == std::string::npos)
+				end = list.size();
+
+			if (end > start) {
+				archives.emplace_back(BethesdaArchive::open(list.substr(start, end - start)));
+			}
+
+			start = end + 1;
+		}
+
+		m_archives = std::move(archives);
+		m_list = list;
+	}
+
+	bool ArchiveSet::findEntry(const std::string &normalizedName, Location &location) const {
+		for (const auto &archive : m_archives) {
+			auto entry = archive->find(normalizedName);
+			if (entry) {
+				location.archive = archive.get();
+				location.entry = entry;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool ArchiveSet::find(const std::string &name, Location &location, std::string *entryName) const {
+		if (m_archives.empty())
+			return false;
+
+		auto candidate = BethesdaArchive::normalizeName(name);
+
+		if (!findEntry(candidate, location)) {
+			// Data directory names: Data for later games, Data Files for Morrowind
+			static const char *const dataDirectories[]{ "data\\", "data files\\" };
+
+			size_t start = std::string::npos;
+			for (auto directory : dataDirectories) {
+				std::string component(directory);
+				size_t end;
+
+				auto position = candidate.rfind("\\" + component);
+				if (position != std::string::npos) {
+					end = position + 1 + component.size();
+				}
+				else if (candidate.compare(0, component.size(), component) == 0) {
+					end = component.size();
+				}
+				else {
+					continue;
+				}
+
+				if (start == std::string::npos || end > start)
+					start = end;
+			}
+
+			if (start == std::string::npos)
+				return false;
+
+			candidate.erase(0, start);
+			if (candidate.empty() || !findEntry(candidate, location))
+				return false;
+		}
+
+		if (entryName)
+			*entryName = std::move(candidate);
+
+		return true;
+	}
+
+	bool ArchiveSet::resolveAsset(const std::string &name, std::string &archiveName, std::string &entryName) const {
+		Location location;
+		if (!find(name, location, &entryName))
+			return false;
+
+		archiveName = location.archive->path();
+		return true;
+	}
+
+	bool ArchiveSet::readAsset(const std::string &entryName, std::vector<unsigned char> &data) const {
+		Location location;
+		if (!find(entryName, location))
+			return false;
+
+		auto contents = location.archive->read(*location.entry, data);
+		if (contents.first != data.data()) {
+			data.assign(contents.first, contents.first + contents.second);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef ARCHIVE_SET_H
+#define ARCHIVE_SET_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <NIF2FBXAssetSource.h>
+
+#include "BethesdaArchive.h"
+
+namespace fbxnif {
+	/*
+	 * Ordered list of archives searched by name, highest priority first.
+	 */
+	class ArchiveSet final : public NIF2FBXAssetSource {
+	public:
+		struct Location {
+			const BethesdaArchive *archive;
+			const BethesdaArchive::Entry *entry;
+		};
+
+		ArchiveSet();
+		~ArchiveSet();
+
+		// Semicolon-separated list of archive paths
+		void setArchives(const std::string &list);
+
+		inline bool empty() const { return m_archives.empty(); }
+		inline const std::string &list() const { return m_list; }
+
+		/*
+		 * Looks the name up as given, then, if the path contains a Data
+		 * directory, relative to the last one, so that absolute paths of
+		 * files inside an extracted data directory resolve to their
+		 * archived counterparts.
+		 */
+		bool find(const std::string &name, Location &location, std::string *entryName = nullptr) const;
+
+		virtual bool resolveAsset(const std::string &name, std::string &archiveName, std::string &entryName) const override;
+		virtual bool readAsset(const std::string &entryName, std::vector<unsigned char> &data) const override;
+
+	private:
+		bool findEntry(const std::string &normalizedName, Location &location) const;
+
+		std::string m_list;
+		std::vector<std::shared_ptr<const BethesdaArchive>> m_archives;
+	};
+}
+
+#endif
@@ -0,0 +1,165 @@
+#include "BSVertexDecoder.h"
+#include "NIFSymbols.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BS_VERTEX_DECODER_SSE2
+#endif
+
+namespace fbxnif {
+	namespace {
+		/*
+		 * out[i] = (in[i] / 255) * scale + bias, which is getUnsignedFloatFromU8
+		 * for scale 1, bias 0 and getSignedFloatFromU8 for scale 2, bias -1.
+		 */
+		void convertBytes(const uint8_t *in, float *out, size_t count, float scale, float bias) {
+			size_t index = 0;
+
+#ifdef BS_VERTEX_DECODER_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			const __m128 divisor = _mm_set1_ps(255.0f);
+			const __m128 scaleVector = _mm_set1_ps(scale);
+			const __m128 biasVector = _mm_set1_ps(bias);
+
+			for (; index + 16 <= count; index += 16) {
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + index));
+				__m128i low = _mm_unpacklo_epi8(bytes, zero);
+				__m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+				__m128i words[4] = {
+					_mm_unpacklo_epi16(low, zero),
+					_mm_unpackhi_epi16(low, zero),
+					_mm_unpacklo_epi16(high, zero),
+					_mm_unpackhi_epi16(high, zero)
+				};
+
+				for (int part = 0; part < 4; part++) {
+					__m128 value = _mm_div_ps(_mm_cvtepi32_ps(words[part]), divisor);
+					_mm_storeu_ps(out + index + part * 4, _mm_add_ps(_mm_mul_ps(value, scaleVector), biasVector));
+				}
+			}
+#endif
+
+			for (; index < count; index++) {
+				out[index] = (static_cast<float>(in[index]) / 255.0f) * scale + bias;
+			}
+		}
+	}
+
+	BSVertexDecoder::BSVertexDecoder() : m_vertexCount(0) {
+
+	}
+
+	BSVertexDecoder::~BSVertexDecoder() = default;
+
+	void BSVertexDecoder::decode(const NIFArray &vertexData, size_t vertexCount, const NIFBitflags &attributes) {
+		const auto &sym = symbols();
+
+		bool hasPositions = false, hasUVs = false, hasNormals = false, hasTangents = false, hasColors = false;
+
+		for (const auto &attribute : attributes.symbolicValues) {
+			if (attribute == sym.vertex) {
+				hasPositions = true;
+			}
+			else if (attribute == sym.uvsAttribute) {
+				hasUVs = true;
+			}
+			else if (attribute == sym.normalsAttribute) {
+				hasNormals = true;
+			}
+			else if (attribute == sym.tangentsAttribute) {
+				hasTangents = true;
+			}
+			else if (attribute == sym.vertexColorsAttribute) {
+				hasColors = true;
+			}
+			else {
+				fprintf(stderr, "Unsupported vertex attribute: %s\n", attribute.toString());
+			}
+		}
+
+		if (vertexData.data.size() < vertexCount) {
+			throw std::logic_error("BSTriShape has less vertex data than vertices");
+		}
+
+		m_vertexCount = vertexCount;
+		m_positions.resize(hasPositions ? vertexCount * 3 : 0);
+		m_uvs.resize(hasUVs ? vertexCount * 2 : 0);
+		m_normalBytes.resize(hasNormals ? vertexCount * 3 : 0);
+		m_tangentBytes.resize(hasTangents ? vertexCount * 3 : 0);
+		m_bitangents.resize(hasTangents ? vertexCount * 3 : 0);
+		m_bitangentBytes.resize(hasTangents ? vertexCount * 2 : 0);
+		m_colorBytes.resize(hasColors ? vertexCount * 4 : 0);
+
+		auto positions = m_positions.data();
+		auto uvs = m_uvs.data();
+		auto normalBytes = m_normalBytes.data();
+		auto tangentBytes = m_tangentBytes.data();
+		auto bitangents = m_bitangents.data();
+		auto bitangentBytes = m_bitangentBytes.data();
+		auto colorBytes = m_colorBytes.data();
+
+		for (size_t index = 0; index < vertexCount; index++) {
+			const auto &vertex = std::get<NIFDictionary>(vertexData.data[index]);
+
+			if (hasPositions) {
+				const auto &position = vertex.getValue<NIFDictionary>(sym.vertex);
+				*positions++ = position.getValue<float>(sym.x);
+				*positions++ = position.getValue<float>(sym.y);
+				*positions++ = position.getValue<float>(sym.z);
+			}
+
+			if (hasUVs) {
+				const auto &uv = vertex.getValue<NIFDictionary>(sym.uv);
+				*uvs++ = uv.getValue<float>(sym.u);
+				*uvs++ = uv.getValue<float>(sym.v);
+			}
+
+			if (hasNormals) {
+				const auto &normal = vertex.getValue<NIFDictionary>(sym.normal);
+				*normalBytes++ = static_cast<uint8_t>(normal.getValue<uint32_t>(sym.x));
+				*normalBytes++ = static_cast<uint8_t>(normal.getValue<uint32_t>(sym.y));
+				*normalBytes++ = static_cast<uint8_t>(normal.getValue<uint32_t>(sym.z));
+			}
+
+			if (hasTangents) {
+				const auto &tangent = vertex.getValue<NIFDictionary>(sym.tangent);
+				*tangentBytes++ = static_cast<uint8_t>(tangent.getValue<uint32_t>(sym.x));
+				*tangentBytes++ = static_cast<uint8_t>(tangent.getValue<uint32_t>(sym.y));
+				*tangentBytes++ = static_cast<uint8_t>(tangent.getValue<uint32_t>(sym.z));
+
+				*bitangents = vertex.getValue<float>(sym.bitangentX);
+				bitangents += 3;
+				*bitangentBytes++ = static_cast<uint8_t>(vertex.getValue<uint32_t>(sym.bitangentY));
+				*bitangentBytes++ = static_cast<uint8_t>(vertex.getValue<uint32_t>(sym.bitangentZ));
+			}
+
+			if (hasColors) {
+				const auto &color = vertex.getValue<NIFDictionary>(sym.vertexColors);
+				*colorBytes++ = static_cast<uint8_t>(color.getValue<uint32_t>(sym.r));
+				*colorBytes++ = static_cast<uint8_t>(color.getValue<uint32_t>(sym.g));
+				*colorBytes++ = static_cast<uint8_t>(color.getValue<uint32_t>(sym.b));
+				*colorBytes++ = static_cast<uint8_t>(color.getValue<uint32_t>(sym.a));
+			}
+		}
+
+		m_normals.resize(m_normalBytes.size());
+		convertBytes(m_normalBytes.data(), m_normals.data(), m_normalBytes.size(), 2.0f, -1.0f);
+
+		m_tangents.resize(m_tangentBytes.size());
+		convertBytes(m_tangentBytes.data(), m_tangents.data(), m_tangentBytes.size(), 2.0f, -1.0f);
+
+		m_bitangentYZ.resize(m_bitangentBytes.size());
+		convertBytes(m_bitangentBytes.data(), m_bitangentYZ.data(), m_bitangentBytes.size(), 2.0f, -1.0f);
+		for (size_t index = 0, size = m_bitangentYZ.size() / 2; index < size; index++) {
+			m_bitangents[index * 3 + 1] = m_bitangentYZ[index * 2];
+			m_bitangents[index * 3 + 2] = m_bitangentYZ[index * 2 + 1];
+		}
+
+		m_colors.resize(m_colorBytes.size());
+		convertBytes(m_colorBytes.data(), m_colors.data(), m_colorBytes.size(), 1.0f, 0.0f);
+	}
+}
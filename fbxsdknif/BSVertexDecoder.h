@@ -0,0 +1,58 @@
+#ifndef BS_VERTEX_DECODER_H
+#define BS_VERTEX_DECODER_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <nifparse/Types.h>
+
+#include <vector>
+
+namespace fbxnif {
+	/*
+	 * Decodes BSTriShape vertex data into one array per attribute in a
+	 * single sweep over the vertices. Arrays of attributes that are not in
+	 * the vertex description are left empty.
+	 */
+	class BSVertexDecoder {
+	public:
+		BSVertexDecoder();
+		~BSVertexDecoder();
+
+		BSVertexDecoder(const BSVertexDecoder &other) = delete;
+		BSVertexDecoder &operator =(const BSVertexDecoder &other) = delete;
+
+		void decode(const NIFArray &vertexData, size_t vertexCount, const NIFBitflags &attributes);
+
+		inline size_t vertexCount() const { return m_vertexCount; }
+
+		// xyz per vertex
+		inline const std::vector<float> &positions() const { return m_positions; }
+		inline const std::vector<float> &normals() const { return m_normals; }
+		inline const std::vector<float> &tangents() const { return m_tangents; }
+		inline const std::vector<float> &bitangents() const { return m_bitangents; }
+
+		// uv per vertex
+		inline const std::vector<float> &uvs() const { return m_uvs; }
+
+		// rgba per vertex
+		inline const std::vector<float> &colors() const { return m_colors; }
+
+	private:
+		size_t m_vertexCount;
+		std::vector<float> m_positions;
+		std::vector<float> m_normals;
+		std::vector<float> m_tangents;
+		std::vector<float> m_bitangents;
+		std::vector<float> m_uvs;
+		std::vector<float> m_colors;
+
+		// Byte-normalized attributes as stored, converted after the sweep
+		std::vector<uint8_t> m_normalBytes;
+		std::vector<uint8_t> m_tangentBytes;
+		std::vector<uint8_t> m_bitangentBytes;
+		std::vector<uint8_t> m_colorBytes;
+		std::vector<float> m_bitangentYZ;
+	};
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "BSplineDataSet.h"
 #include "BSplineTrackDefinition.h"
+#include "NIFUtils.h"
 
 #include <array>
 
@@ -36,8 +37,8 @@ namespace fbxnif {
 
 		result.resize(numControlPoints);
 
-		if (interpolator.data.count(def.offsetKey) != 0) {
-			auto offset = interpolator.getValue<float>(def.offsetKey);
+		if (auto offsetValue = findValue<float>(interpolator, def.offsetKey)) {
+			auto offset = *offsetValue;
 			auto halfRange = interpolator.getValue<float>(def.halfRangeKey);
 
 			auto numControlPoints = splineData.getValue<uint32_t>("Num Compact Control Points");
@@ -0,0 +1,370 @@
+#include "BethesdaArchive.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <mutex>
+
+#ifdef NIF2FBX_ZLIB
+#include <zlib.h>
+#endif
+
+#include "LZ4Decoder.h"
+
+namespace fbxnif {
+	enum : uint32_t {
+		TES3ArchiveVersion = 0x100,
+
+		TES4ArchiveMagic = 0x00415342, // 'BSA\0'
+		TES4ArchiveVersionOblivion = 103,
+		TES4ArchiveVersionSkyrim = 104,
+		TES4ArchiveVersionSkyrimSE = 105,
+
+		TES4ArchiveFlagDirectoryNames = 1 << 0,
+		TES4ArchiveFlagFileNames = 1 << 1,
+		TES4ArchiveFlagCompressed = 1 << 2,
+		TES4ArchiveFlagEmbeddedNames = 1 << 8,
+
+		TES4FileSizeMask = 0x3FFFFFFF,
+		TES4FileFlagToggleCompression = 1 << 30,
+
+		BA2ArchiveMagic = 0x58445442, // 'BTDX'
+		BA2ArchiveTypeGeneral = 0x4C524E47, // 'GNRL'
+		BA2ArchiveTypeTexture = 0x30315844, // 'DX10'
+		BA2CompressionLZ4 = 3
+	};
+
+	BethesdaArchive::BethesdaArchive(const std::string &path) : m_path(path), m_compression(Compression::Zlib), m_embeddedNames(false) {
+		m_file.open(path.c_str());
+
+		auto magic = readValue<uint32_t>(0);
+		if (magic == TES3ArchiveVersion) {
+			m_format = Format::TES3;
+			indexTES3();
+		}
+		else if (magic == TES4ArchiveMagic) {
+			m_format = Format::TES4;
+			indexTES4();
+		}
+		else if (magic == BA2ArchiveMagic) {
+			m_format = Format::BA2;
+			indexBA2();
+		}
+		else {
+			throw std::runtime_error(path + ": not a BSA or BA2 archive");
+		}
+	}
+
+	BethesdaArchive::~BethesdaArchive() = default;
+
+	std::shared_ptr<const BethesdaArchive> BethesdaArchive::open(const std::string &path) {
+		static std::mutex cacheMutex;
+		static std::unordered_map<std::string, std::shared_ptr<const BethesdaArchive>> cache;
+
+		std::unique_lock<std::mutex> locker(cacheMutex);
+
+		auto it = cache.find(path);
+		if (it != cache.end())
+			return it->second;
+
+		std::shared_ptr<const BethesdaArchive> archive(new BethesdaArchive(path));
+		cache.emplace(path, archive);
+		return archive;
+	}
+
+	std::string BethesdaArchive::normalizeName(const std::string &name) {
+		std::string result;
+		result.reserve(name.size());
+
+		for (auto ch : name) {
+			if (ch == '/')
+				ch = '\\';
+			else if (ch >= 'A' && ch <= 'Z')
+				ch = static_cast<char>(ch - 'A' + 'a');
+
+			if (ch == '\\' && (result.empty() || result.back() == '\\'))
+				continue;
+
+			result.push_back(ch);
+		}
+
+		return result;
+	}
+
+	template<typename T>
+	T BethesdaArchive::readValue(uint64_t offset) const {
+		if (offset > m_file.size() || m_file.size() - offset < sizeof(T))
+			throw std::runtime_error(m_path + ": archive is truncated");
+
+		T value;
+		memcpy(&value, m_file.data() + offset, sizeof(T));
+		return value;
+	}
+
+	void BethesdaArchive::addEntry(const std::string &name, const Entry &entry) {
+		if (entry.offset > m_file.size() || m_file.size() - entry.offset < entry.size)
+			throw std::runtime_error(m_path + ": entry is out of bounds: " + name);
+
+		// First record wins, matching the lookup order of the games themselves
+		m_entries.emplace(normalizeName(name), entry);
+	}
+
+	auto BethesdaArchive::find(const std::string &normalizedName) const -> const Entry * {
+		auto it = m_entries.find(normalizedName);
+		if (it == m_entries.end())
+			return nullptr;
+
+		return &it->second;
+	}
+
+	/*
+	 * Morrowind: flat list of sizes and offsets, followed by a name offset
+	 * table, the names themselves and a hash table.
+	 */
+	void BethesdaArchive::indexTES3() {
+		auto hashOffset = readValue<uint32_t>(4);
+		auto fileCount = readValue<uint32_t>(8);
+
+		uint64_t recordsOffset = 12;
+		uint64_t nameOffsetsOffset = recordsOffset + 8ULL * fileCount;
+		uint64_t namesOffset = nameOffsetsOffset + 4ULL * fileCount;
+		uint64_t dataOffset = 12ULL + hashOffset + 8ULL * fileCount;
+
+		m_entries.reserve(fileCount);
+
+		for (uint32_t index = 0; index < fileCount; index++) {
+			Entry entry;
+			entry.size = readValue<uint32_t>(recordsOffset + 8ULL * index);
+			entry.offset = dataOffset + readValue<uint32_t>(recordsOffset + 8ULL * index + 4);
+			entry.unpackedSize = entry.size;
+			entry.compressed = false;
+			entry.texture = false;
+
+			auto nameOffset = namesOffset + readValue<uint32_t>(nameOffsetsOffset + 4ULL * index);
+			if (nameOffset >= m_file.size())
+				throw std::runtime_error(m_path + ": archive is truncated");
+
+			auto name = reinterpret_cast<const char *>(m_file.data() + nameOffset);
+			addEntry(std::string(name, strnlen(name, m_file.size() - nameOffset)), entry);
+		}
+	}
+
+	/*
+	 * Oblivion through Skyrim SE: folder records, then per folder its name
+	 * and file records, then a block with all file names in record order.
+	 */
+	void BethesdaArchive::indexTES4() {
+		auto version = readValue<uint32_t>(4);
+		if (version != TES4ArchiveVersionOblivion && version != TES4ArchiveVersionSkyrim && version != TES4ArchiveVersionSkyrimSE)
+			throw std::runtime_error(m_path + ": unsupported BSA version " + std::to_string(version));
+
+		auto headerSize = readValue<uint32_t>(8);
+		auto archiveFlags = readValue<uint32_t>(12);
+		auto folderCount = readValue<uint32_t>(16);
+		auto fileCount = readValue<uint32_t>(20);
+
+		if ((archiveFlags & TES4ArchiveFlagDirectoryNames) == 0 || (archiveFlags & TES4ArchiveFlagFileNames) == 0)
+			throw std::runtime_error(m_path + ": archives without name tables are not supported");
+
+		auto compressedByDefault = (archiveFlags & TES4ArchiveFlagCompressed) != 0;
+		m_embeddedNames = version != TES4ArchiveVersionOblivion && (archiveFlags & TES4ArchiveFlagEmbeddedNames) != 0;
+
+		if (version == TES4ArchiveVersionSkyrimSE)
+			m_compression = Compression::LZ4Frame;
+
+		uint64_t folderRecordSize = version == TES4ArchiveVersionSkyrimSE ? 24 : 16;
+
+		// File records of all folders are laid out back to back, each group prefixed with the folder name
+		uint64_t position = headerSize + folderRecordSize * folderCount;
+
+		std::vector<std::pair<std::string, Entry>> files;
+		files.reserve(fileCount);
+
+		for (uint32_t folder = 0; folder < folderCount; folder++) {
+			auto folderFileCount = readValue<uint32_t>(headerSize + folderRecordSize * folder + 8);
+
+			auto nameLength = readValue<uint8_t>(position);
+			position++;
+
+			if (nameLength == 0 || position + nameLength > m_file.size())
+				throw std::runtime_error(m_path + ": archive is truncated");
+
+			std::string folderName(reinterpret_cast<const char *>(m_file.data() + position), nameLength - 1);
+			position += nameLength;
+
+			for (uint32_t file = 0; file < folderFileCount; file++) {
+				auto sizeAndFlags = readValue<uint32_t>(position + 8);
+
+				Entry entry;
+				entry.size = sizeAndFlags & TES4FileSizeMask;
+				entry.offset = readValue<uint32_t>(position + 12);
+				entry.unpackedSize = 0;
+				entry.compressed = compressedByDefault != ((sizeAndFlags & TES4FileFlagToggleCompression) != 0);
+				entry.texture = false;
+
+				files.emplace_back(folderName, entry);
+
+				position += 16;
+			}
+		}
+
+		if (files.size() != fileCount)
+			throw std::runtime_error(m_path + ": file count mismatch");
+
+		m_entries.reserve(fileCount);
+
+		for (auto &file : files) {
+			if (position >= m_file.size())
+				throw std::runtime_error(m_path + ": archive is truncated");
+
+			auto name = reinterpret_cast<const char *>(m_file.data() + position);
+			auto length = strnlen(name, m_file.size() - position);
+			position += length + 1;
+
+			addEntry(file.first + "\\" + std::string(name, length), file.second);
+		}
+	}
+
+	/*
+	 * Fallout 4: fixed-size general records or variable-size texture records,
+	 * with a table of length-prefixed names at the end of the archive.
+	 */
+	void BethesdaArchive::indexBA2() {
+		auto version = readValue<uint32_t>(4);
+		auto type = readValue<uint32_t>(8);
+		auto fileCount = readValue<uint32_t>(12);
+		auto nameTableOffset = readValue<uint64_t>(16);
+
+		uint64_t position;
+		uint32_t compression = 0;
+
+		switch (version) {
+		case 1:
+		case 7:
+		case 8:
+			position = 24;
+			break;
+
+		case 2:
+			position = 32;
+			break;
+
+		case 3:
+			compression = readValue<uint32_t>(32);
+			position = 36;
+			break;
+
+		default:
+			throw std::runtime_error(m_path + ": unsupported BA2 version " + std::to_string(version));
+		}
+
+		if (compression == BA2CompressionLZ4)
+			m_compression = Compression::LZ4Block;
+		else if (compression != 0)
+			throw std::runtime_error(m_path + ": unsupported BA2 compression");
+
+		std::vector<Entry> entries;
+		entries.reserve(fileCount);
+
+		for (uint32_t file = 0; file < fileCount; file++) {
+			Entry entry;
+
+			if (type == BA2ArchiveTypeGeneral) {
+				entry.offset = readValue<uint64_t>(position + 16);
+				auto packedSize = readValue<uint32_t>(position + 24);
+				entry.unpackedSize = readValue<uint32_t>(position + 28);
+				entry.compressed = packedSize != 0;
+				entry.size = entry.compressed ? packedSize : entry.unpackedSize;
+				entry.texture = false;
+
+				position += 36;
+			}
+			else if (type == BA2ArchiveTypeTexture) {
+				// Texture contents are split into mip chunks and have no DDS header; only the name is indexed
+				auto chunkCount = readValue<uint8_t>(position + 13);
+
+				entry.offset = 0;
+				entry.size = 0;
+				entry.unpackedSize = 0;
+				entry.compressed = false;
+				entry.texture = true;
+
+				position += 24 + 24ULL * chunkCount;
+			}
+			else {
+				throw std::runtime_error(m_path + ": unsupported BA2 archive type");
+			}
+
+			entries.emplace_back(entry);
+		}
+
+		m_entries.reserve(fileCount);
+
+		position = nameTableOffset;
+
+		for (const auto &entry : entries) {
+			auto length = readValue<uint16_t>(position);
+			position += 2;
+
+			if (position + length > m_file.size())
+				throw std::runtime_error(m_path + ": archive is truncated");
+
+			addEntry(std::string(reinterpret_cast<const char *>(m_file.data() + position), length), entry);
+			position += length;
+		}
+	}
+
+	std::pair<const unsigned char *, size_t> BethesdaArchive::read(const Entry &entry, std::vector<unsigned char> &storage) const {
+		if (entry.texture)
+			throw std::runtime_error(m_path + ": reading BA2 texture entries is not supported");
+
+		auto data = m_file.data() + entry.offset;
+		size_t size = entry.size;
+
+		if (m_embeddedNames) {
+			auto nameLength = readValue<uint8_t>(entry.offset);
+			if (nameLength + 1U > size)
+				throw std::runtime_error(m_path + ": entry is truncated");
+
+			data += nameLength + 1;
+			size -= nameLength + 1;
+		}
+
+		if (!entry.compressed)
+			return { data, size };
+
+		size_t unpackedSize = entry.unpackedSize;
+
+		if (m_format == Format::TES4) {
+			if (size < 4)
+				throw std::runtime_error(m_path + ": entry is truncated");
+
+			uint32_t originalSize;
+			memcpy(&originalSize, data, sizeof(originalSize));
+			unpackedSize = originalSize;
+
+			data += 4;
+			size -= 4;
+		}
+
+		storage.resize(unpackedSize);
+
+		if (m_compression == Compression::LZ4Frame) {
+			decompressLZ4Frame(data, size, storage.data(), storage.size());
+		}
+		else if (m_compression == Compression::LZ4Block) {
+			decompressLZ4Block(data, size, storage.data(), storage.size());
+		}
+		else {
+#ifdef NIF2FBX_ZLIB
+			auto destinationSize = static_cast<uLongf>(storage.size());
+			auto result = uncompress(storage.data(), &destinationSize, data, static_cast<uLong>(size));
+			if (result != Z_OK || destinationSize != storage.size())
+				throw std::runtime_error(m_path + ": failed to decompress entry");
+#else
+			throw std::runtime_error(m_path + ": zlib-compressed entries require building with NIF2FBX_ZLIB");
+#endif
+		}
+
+		return { storage.data(), storage.size() };
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef BETHESDA_ARCHIVE_H
+#define BETHESDA_ARCHIVE_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "MemoryMappedFile.h"
+
+namespace fbxnif {
+	/*
+	 * Read-only access to Bethesda game archives: Morrowind BSA, Oblivion
+	 * through Skyrim SE BSA (versions 103-105) and Fallout 4 BA2. The archive
+	 * is memory mapped and its folder and file records are indexed once, when
+	 * opened; entries are decompressed on demand. zlib-compressed entries
+	 * (BSA versions before Skyrim SE) are only supported when built with the
+	 * NIF2FBX_ZLIB option.
+	 */
+	class BethesdaArchive {
+	public:
+		struct Entry {
+			uint64_t offset;
+			uint32_t size;
+			uint32_t unpackedSize;
+			bool compressed;
+			bool texture;
+		};
+
+		~BethesdaArchive();
+
+		BethesdaArchive(const BethesdaArchive &other) = delete;
+		BethesdaArchive &operator =(const BethesdaArchive &other) = delete;
+
+		/*
+		 * Archives are cached for the lifetime of the process, so that batch
+		 * conversions only map and index every archive once.
+		 */
+		static std::shared_ptr<const BethesdaArchive> open(const std::string &path);
+
+		static std::string normalizeName(const std::string &name);
+
+		inline const std::string &path() const { return m_path; }
+
+		// Expects a name already passed through normalizeName
+		const Entry *find(const std::string &normalizedName) const;
+
+		/*
+		 * Returns the entry contents. Uncompressed entries are returned in place,
+		 * from the mapping; compressed ones are decompressed into storage.
+		 */
+		std::pair<const unsigned char *, size_t> read(const Entry &entry, std::vector<unsigned char> &storage) const;
+
+	private:
+		enum class Format {
+			TES3,
+			TES4,
+			BA2
+		};
+
+		enum class Compression {
+			Zlib,
+			LZ4Frame,
+			LZ4Block
+		};
+
+		explicit BethesdaArchive(const std::string &path);
+
+		void indexTES3();
+		void indexTES4();
+		void indexBA2();
+
+		template<typename T>
+		T readValue(uint64_t offset) const;
+
+		void addEntry(const std::string &name, const Entry &entry);
+
+		std::string m_path;
+		MemoryMappedFile m_file;
+		Format m_format;
+		Compression m_compression;
+		bool m_embeddedNames;
+		std::unordered_map<std::string, Entry> m_entries;
+	};
+}
+
+#endif
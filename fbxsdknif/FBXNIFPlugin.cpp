@@ -4,6 +4,7 @@
 #include <fbxsdk/fileio/fbxiopluginregistry.h>
 
 #include "NIFReader.h"
+#include "TextureNameCache.h"
 
 namespace fbxnif {
 	FBXNIFPlugin::FBXNIFPlugin(const fbxsdk::FbxPluginDef &definition, fbxsdk::FbxModule moduleHandle) : FbxPlugin(definition, moduleHandle) {
@@ -19,6 +20,8 @@ namespace fbxnif {
 	}
 
 	bool FBXNIFPlugin::SpecificTerminate() {
+		TextureNameCache::clear();
+
 		return true;
 	}
 
@@ -18,7 +18,11 @@
 #include <nifparse/NIFFile.h>
 #include <nifparse/PrettyPrinter.h>
 
+#include <algorithm>
 #include <array>
+#include <cctype>
+#include <condition_variable>
+#include <mutex>
 
 #include <json.h>
 
@@ -28,22 +32,117 @@
 #include "BSplineTrackDefinition.h"
 #include "BSplineDataSet.h"
 #include "JsonUtils.h"
+#include "NIFSymbols.h"
+#include "TextureNameCache.h"
 
 #include <NIF2FBXExtension.h>
+#include <NIF2FBXAssetSource.h>
 
 namespace fbxnif {
-	FBXSceneWriter::FBXSceneWriter(const NIFFile &file, const SkeletonProcessor &skeleton) : m_file(file), m_skeleton(skeleton), m_vertexColorVertexMode(0), m_vertexColorLightingMode(1), m_extension(nullptr) {
+	/*
+	 * Receives the results of NIF2FBXExtension2::translateTextureAssets,
+	 * possibly from another thread. It is not destroyed until the extension
+	 * reports completion.
+	 */
+	class FBXSceneWriter::TextureTranslationRequest final : public NIF2FBXTextureTranslationCallback {
+	public:
+		struct Translation {
+			std::string originalName;
+			std::string assetName;
+			std::string fileName;
+		};
 
+		TextureTranslationRequest() : m_complete(false) {
+
+		}
+
+		~TextureTranslationRequest() {
+			wait();
+		}
+
+		virtual void textureAssetTranslated(const std::string &originalName, const std::string &assetName, const std::string &fileName) override {
+			std::unique_lock<std::mutex> locker(m_mutex);
+
+			m_translations.emplace_back(Translation{ originalName, assetName, fileName });
+		}
+
+		virtual void textureAssetTranslationsComplete() override {
+			std::unique_lock<std::mutex> locker(m_mutex);
+
+			m_complete = true;
+			m_completed.notify_all();
+		}
+
+		std::vector<Translation> take() {
+			wait();
+
+			std::unique_lock<std::mutex> locker(m_mutex);
+			return std::move(m_translations);
+		}
+
+	private:
+		void wait() {
+			std::unique_lock<std::mutex> locker(m_mutex);
+
+			m_completed.wait(locker, [this]() { return m_complete; });
+		}
+
+		std::mutex m_mutex;
+		std::condition_variable m_completed;
+		std::vector<Translation> m_translations;
+		bool m_complete;
+	};
+
+	FBXSceneWriter::FBXSceneWriter(const NIFFile &file, const SkeletonProcessor &skeleton) : m_file(file), m_skeleton(skeleton), m_vertexColorVertexMode(0), m_vertexColorLightingMode(1), m_extension(nullptr), m_extensionVersion(1), m_assetSource(nullptr), m_singlePass(false), m_reusingMaterial(false) {
+		const auto &sym = symbols();
+
+		m_sceneNodeHandlers.add(sym.niNode, [this](const NIFDictionary &dict, FbxNode *node, Pass pass) { convertNiNode(dict, node, pass); });
+		m_sceneNodeHandlers.add(sym.niTriBasedGeom, [this](const NIFDictionary &dict, FbxNode *node, Pass pass) { convertNiTriBasedGeom(dict, node, pass); });
+		m_sceneNodeHandlers.add(sym.bsTriShape, [this](const NIFDictionary &dict, FbxNode *node, Pass pass) { convertBSTriShape(dict, node, pass); }, false);
+
+		m_propertyHandlers.add(sym.niMaterialProperty, [this](const NIFDictionary &prop, FbxNode *node, Pass pass) { processMaterialProperty(prop, node, pass); });
+		m_propertyHandlers.add(sym.niTexturingProperty, [this](const NIFDictionary &prop, FbxNode *node, Pass pass) { processTexturingProperty(prop, node, pass); });
+		m_propertyHandlers.add(sym.niAlphaProperty, [this](const NIFDictionary &prop, FbxNode *node, Pass pass) { processAlphaProperty(prop, node, pass); });
+		m_propertyHandlers.add(sym.niVertexColorProperty, [this](const NIFDictionary &prop, FbxNode *node, Pass pass) { processVertexColorProperty(prop, node, pass); });
+
+		m_controllerHandlers.add(sym.niKeyframeController, [this](const NIFDictionary &controller, FbxNode *node) { processKeyframeController(controller, node); });
+		m_controllerHandlers.add(sym.niControllerManager, [this](const NIFDictionary &controller, FbxNode *node) { processControllerManager(controller, node); });
+		m_controllerHandlers.add(sym.niGeomMorpherController, [this](const NIFDictionary &controller, FbxNode *node) { processGeomMorpherController(controller, node); });
 	}
 
 	FBXSceneWriter::~FBXSceneWriter() = default;
 
+	void FBXSceneWriter::registerSceneNodeHandler(const Symbol &type, BlockHandler handler, bool includeSubclasses) {
+		m_sceneNodeHandlers.add(type, std::move(handler), includeSubclasses);
+	}
+
+	void FBXSceneWriter::registerPropertyHandler(const Symbol &type, BlockHandler handler, bool includeSubclasses) {
+		m_propertyHandlers.add(type, std::move(handler), includeSubclasses);
+	}
+
+	void FBXSceneWriter::registerControllerHandler(const Symbol &type, ControllerHandler handler, bool includeSubclasses) {
+		m_controllerHandlers.add(type, std::move(handler), includeSubclasses);
+	}
+
 	void FBXSceneWriter::write(FbxDocument *document) {
 		m_scene = FbxCast<FbxScene>(document);
 
 		m_meshesGenerated = 0;
 		m_skeletonNodesGenerated = 0;
 		m_skeletonImported = false;
+		m_deferred.clear();
+		m_nodeMap.assign(m_skeleton.nodeCount(), nullptr);
+		m_nodesByName.clear();
+		m_sharedMeshes.clear();
+		m_materialCache.clear();
+		m_extendedMaterialData.clear();
+		m_textures.clear();
+		m_textureSources.clear();
+		m_pendingTextureTranslations.reset();
+		m_textureTranslations.clear();
+		m_vertexColorVertexMode = 0;
+		m_vertexColorLightingMode = 1;
+		m_reusingMaterial = false;
 
 		if (m_file.rootObjects().data.empty()) {
 			throw std::runtime_error("no root object in NIF");
@@ -55,20 +154,41 @@ namespace fbxnif {
 		const auto &root = std::get<NIFReference>(m_file.rootObjects().data.front());
 		const auto &rootDict = std::get<NIFDictionary>(*root.ptr);
 
-		if (rootDict.kindOf("NiAVObject")) {
-			printf("Starting structural pass\n");
+		if (rootDict.kindOf(symbols().niAVObject)) {
+			if (extension2()) {
+				requestTextureTranslations(rootDict);
+			}
 
-			convertSceneNode(root, m_scene->GetRootNode(), Pass::Structural);
+			if (m_singlePass) {
+				printf("Starting single-pass conversion\n");
 
-			printf("Starting geometry pass\n");
+				convertSceneNode(root, m_scene->GetRootNode(), Pass::All);
+			}
+			else {
+				printf("Starting structural pass\n");
 
-			convertSceneNode(root, m_scene->GetRootNode(), Pass::Geometry);
-			
-			printf("Starting animation pass\n");
+				convertSceneNode(root, m_scene->GetRootNode(), Pass::Structural);
+
+				printf("Starting geometry pass\n");
 
-			convertSceneNode(root, m_scene->GetRootNode(), Pass::Animation);
+				convertSceneNode(root, m_scene->GetRootNode(), Pass::Geometry);
+
+				printf("Starting animation pass\n");
+
+				convertSceneNode(root, m_scene->GetRootNode(), Pass::Animation);
+			}
+
+			if (!m_deferred.empty()) {
+				printf("Resolving %zu deferred references\n", m_deferred.size());
+
+				for (const auto &deferred : m_deferred) {
+					deferred();
+				}
+
+				m_deferred.clear();
+			}
 		}
-		else if (rootDict.kindOf("NiSequence")) {
+		else if (rootDict.kindOf(symbols().niSequence)) {
 			ensureSkeletonImported(m_scene->GetRootNode());
 
 			processControllerSequence(rootDict, NIFReference());
@@ -76,6 +196,9 @@ namespace fbxnif {
 			m_meshesGenerated++;
 		}
 
+		collectTextureTranslations();
+		writeExtendedMaterialData();
+
 		if (m_meshesGenerated == 0 && m_skeletonNodesGenerated >= 0 /* && m_animationsGenerated == 0 */) {
 			fprintf(stderr, "FBXSceneWriter: skeleton-only FBX generated, adding null geometry\n");
 
@@ -91,8 +214,8 @@ namespace fbxnif {
 				mesh->BeginPolygon();
 				mesh->AddPolygon(0); mesh->AddPolygon(0); mesh->AddPolygon(0);
 				mesh->EndPolygon();
-				auto it = m_nodeMap.find(m_skeleton.commonBoneRoot());
-				auto root = it->second;
+				auto rootIndex = m_skeleton.commonBoneRootIndex();
+				auto root = rootIndex == SkeletonProcessor::NoNode ? nullptr : m_nodeMap[rootIndex];
 				auto fbxSkin = FbxSkin::Create(m_scene, "");
 				auto cluster = FbxCluster::Create(m_scene, "");
 				cluster->SetLink(root);
@@ -155,16 +278,19 @@ namespace fbxnif {
 	}
 
 	void FBXSceneWriter::convertNiNode(const NIFDictionary &dict, fbxsdk::FbxNode *node, Pass pass) {
+		const auto &sym = symbols();
+
 		ensureSkeletonImported(node);
 
-		if (dict.typeChain.front() == Symbol("RootCollisionNode")) {
-			if (pass == Pass::Geometry)
+		if (dict.typeChain.front() == sym.rootCollisionNode) {
+			pass = withoutPass(pass, Pass::Geometry);
+			if (pass == Pass::None)
 				return;
-		} else if (dict.typeChain.front() != Symbol("NiNode")) {
+		} else if (dict.typeChain.front() != sym.niNode) {
 			fprintf(stderr, "FBXSceneWriter: %s: unsupported NiNode subclass interpreted as NiNode: %s\n", node->GetName(), dict.typeChain.front().toString());
 		}
 	
-		for (const auto &child : dict.getValue<NIFArray>("Children").data) {
+		for (const auto &child : dict.getValue<NIFArray>(sym.children).data) {
 			auto childRef = std::get<NIFReference>(child);
 			if (!childRef.ptr)
 				continue;
@@ -179,11 +305,27 @@ namespace fbxnif {
 			m_importedBoneMap.emplace(bone->GetName(), bone);
 		}
 
+		indexNodeName(bone);
+
 		for (int index = 0, count = bone->GetChildCount(); index < count; index++) {
 			registerImportedBones(bone->GetChild(index));
 		}
 	}
 
+	void FBXSceneWriter::indexNodeName(FbxNode *node) {
+		// The key refers to the node's own name, which is not changed after creation
+		m_nodesByName.emplace(std::string_view(node->GetName()), node);
+	}
+
+	FbxNode *FBXSceneWriter::findNodeByName(std::string_view name) const {
+		auto it = m_nodesByName.find(name);
+		if (it != m_nodesByName.end())
+			return it->second;
+
+		// Nodes not created by the writer itself
+		return m_scene->FindNodeByName(FbxString(name.data(), name.size()));
+	}
+
 	FbxNode *FBXSceneWriter::findSkeletonRoot(FbxNode *parent) {
 		auto skeleton = parent->GetSkeleton();
 		if (skeleton)
@@ -200,45 +342,56 @@ namespace fbxnif {
 	}
 
 	void FBXSceneWriter::convertSceneNode(const NIFReference &var, fbxsdk::FbxNode *containingNode, Pass pass) {
+		const auto &sym = symbols();
+
 		const auto &dict = std::get<NIFDictionary>(*var.ptr);
-		if (!dict.kindOf("NiAVObject")) {
+		if (!dict.kindOf(sym.niAVObject)) {
 			throw std::runtime_error("scene node is not an instance of NiAVObject");
 		}
 
-		const auto &name = getString(dict.getValue<NIFDictionary>("Name"), m_file.header());
+		auto nodeIndex = m_skeleton.nodeIndex(var.ptr.get());
+		if (nodeIndex == SkeletonProcessor::NoNode) {
+			throw std::logic_error("scene node was not indexed");
+		}
+
+		const auto &name = getString(dict.getValue<NIFDictionary>(sym.name), m_file.header());
 
 		auto it = m_importedBoneMap.find(name);
 		if (it != m_importedBoneMap.end()) {
 			fprintf(stderr, "FBXSceneWriter: '%s' is replaced by the imported skeleton\n", name.c_str());
 
-			if (pass == Pass::Structural) {
-				m_nodeMap.emplace(var.ptr, it->second);
+			if (includesPass(pass, Pass::Structural) && !m_nodeMap[nodeIndex]) {
+				m_nodeMap[nodeIndex] = it->second;
 			}
 			return;
 		}
 
 		FbxNode *node;
 
-		if (pass == Pass::Structural) {
-			bool forceHidden = dict.isA("RootCollisionNode");
+		if (includesPass(pass, Pass::Structural)) {
+			bool forceHidden = dict.isA(sym.rootCollisionNode);
 
 			node = FbxNode::Create(m_scene, name.c_str());
 			containingNode->AddChild(node);
 			
-			m_nodeMap.emplace(var.ptr, node);
+			if (!m_nodeMap[nodeIndex]) {
+				m_nodeMap[nodeIndex] = node;
+			}
+			indexNodeName(node);
 
 			fprintf(stderr, "%s: %s\n", node->GetName(), dict.typeChain.front().toString());
 
-			node->Visibility = (dict.getValue<uint32_t>("Flags") & NiAVObjectFlagHidden) == 0 && !forceHidden;
-			node->LclTranslation = getVector3(dict.getValue<NIFDictionary>("Translation"));
-			node->LclRotation = getMatrix3x3(dict.getValue<NIFDictionary>("Rotation")).GetR();
-			node->LclScaling = FbxDouble3(dict.getValue<float>("Scale"));
+			node->Visibility = (dict.getValue<uint32_t>(sym.flags) & NiAVObjectFlagHidden) == 0 && !forceHidden;
+			const auto &transform = m_skeleton.nodeTransform(nodeIndex);
+			node->LclTranslation = transform.translation;
+			node->LclRotation = transform.rotation;
+			node->LclScaling = transform.scaling;
 
-			if (m_skeleton.allBones().count(var.ptr) != 0) {
+			if (m_skeleton.isBone(nodeIndex)) {
 				auto skeleton = FbxSkeleton::Create(m_scene, (std::string(node->GetName()) + " Skeleton").c_str());
 				node->AddNodeAttribute(skeleton);
 
-				if (m_skeleton.commonBoneRoot() == var.ptr) {
+				if (m_skeleton.commonBoneRootIndex() == nodeIndex) {
 					skeleton->SetSkeletonType(FbxSkeleton::eRoot);
 				}
 				else {
@@ -250,62 +403,72 @@ namespace fbxnif {
 		}
 		else {
 
-			auto it = m_nodeMap.find(var.ptr);
-			if (it == m_nodeMap.end())
+			node = m_nodeMap[nodeIndex];
+			if (!node)
 				throw std::logic_error("node not found");
-
-			node = it->second;
 		}
 
-		if (dict.kindOf("NiNode")) {
-			convertNiNode(dict, node, pass);
-		}
-		else if (dict.kindOf("NiTriBasedGeom")) {
-			convertNiTriBasedGeom(dict, node, pass);
+		auto handler = m_sceneNodeHandlers.find(dict);
+		if (!handler) {
+			fprintf(stderr, "FBXSceneWriter: %s: unsupported type: %s\n", node->GetName(), dict.typeChain.front().toString());
 		}
-		else if (dict.isA("BSTriShape")) {
-			convertBSTriShape(dict, node, pass);
+
+		/*
+		 * The vertex color mode of a node applies to its own material and is
+		 * inherited by its children, whatever the order of its property list.
+		 */
+		auto vertexColorVertexMode = m_vertexColorVertexMode;
+		auto vertexColorLightingMode = m_vertexColorLightingMode;
+
+		if (includesPass(pass, Pass::Geometry)) {
+			applyVertexColorProperties(dict, node);
 		}
-		else {
-			fprintf(stderr, "FBXSceneWriter: %s: unsupported type: %s\n", node->GetName(), dict.typeChain.front().toString());
+
+		if (handler) {
+			(*handler)(dict, node, pass);
 		}
 
-		if (pass == Pass::Animation) {
-			for (auto controller = dict.getValue<NIFReference>("Controller"); controller.ptr; controller = std::get<NIFDictionary>(*controller.ptr).getValue<NIFReference>("Next Controller")) {
+		if (includesPass(pass, Pass::Animation)) {
+			for (auto controller = dict.getValue<NIFReference>(sym.controller); controller.ptr; controller = std::get<NIFDictionary>(*controller.ptr).getValue<NIFReference>(sym.nextController)) {
 				processController(std::get<NIFDictionary>(*controller.ptr), node);
 			}
 		}
 
-		if (dict.data.count("Properties") != 0) {
-			for (const auto &prop : dict.getValue<NIFArray>("Properties").data) {
-				const auto &ptr = std::get<NIFReference>(prop).ptr;
-				if (ptr) {
-					processProperty(std::get<NIFDictionary>(*ptr), node, pass);
-				}
-			}
-		}
+		processProperties(dict, node, pass);
+
+		m_vertexColorVertexMode = vertexColorVertexMode;
+		m_vertexColorLightingMode = vertexColorLightingMode;
 	}
 	
 	template<typename ElementType>
 	void FBXSceneWriter::importVectorElement(const NIFDictionary &data, FbxMesh *mesh, const Symbol &name, ElementType *(FbxGeometryBase::*createElement)()) {
-		if (data.data.count(name) != 0) {
-			const auto &vectors = data.getValue<NIFArray>(name);
+		if (auto vectorsValue = findValue<NIFArray>(data, name)) {
+			const auto &vectors = *vectorsValue;
 
 			auto vectorElement = (mesh->*createElement)();
 			vectorElement->SetMappingMode(FbxGeometryElement::eByControlPoint);
 			vectorElement->SetReferenceMode(FbxGeometryElement::eDirect);
 
-			auto &vectorData = vectorElement->GetDirectArray();
-			vectorData.Resize(static_cast<int>(vectors.data.size()));
+			getVector3Array(vectors, m_componentBuffer);
 
-			for (size_t index = 0, size = vectors.data.size(); index < size; index++) {
-				vectorData.SetAt(static_cast<int>(index), getVector3(std::get<NIFDictionary>(vectors.data[index])));
-			}
+			setVectorElementData(vectorElement->GetDirectArray(), m_componentBuffer);
 		}
 	}
 
+	void FBXSceneWriter::setVectorElementData(FbxLayerElementArrayTemplate<FbxVector4> &vectorData, const std::vector<float> &components) {
+		auto size = components.size() / 3;
+		vectorData.Resize(static_cast<int>(size));
+
+		auto vectorValues = vectorData.GetLocked(FbxLayerElementArray::eWriteLock);
+		const float *component = components.data();
+		for (size_t index = 0; index < size; index++, component += 3) {
+			vectorValues[index].Set(component[0], component[1], component[2]);
+		}
+		vectorData.Release(&vectorValues);
+	}
+
 	void FBXSceneWriter::convertNiTriBasedGeom(const NIFDictionary &dict, fbxsdk::FbxNode *node, Pass pass) {
-		if (pass != Pass::Geometry)
+		if (!includesPass(pass, Pass::Geometry))
 			return;
 
 		if (m_file.header().getValue<uint32_t>("Version") == 0x04000002) {
@@ -317,27 +480,95 @@ namespace fbxnif {
 			}
 		}
 
-		Symbol symVertices("Vertices");
-		Symbol symVertexColors("Vertex Colors");
+		const auto &dataPtr = dict.getValue<NIFReference>("Data").ptr;
+		const auto &data = std::get<NIFDictionary>(*dataPtr);
+
+		Symbol symSkinInstance("Skin Instance");
+		auto skinInstanceRef = findValue<NIFReference>(dict, symSkinInstance);
+		bool skinned = skinInstanceRef && skinInstanceRef->ptr;
+
+		/*
+		 * Geometry referencing the same data block shares one mesh, unless it
+		 * is skinned or morphed: deformers are attached to the mesh.
+		 */
+		bool morphed = false;
+		for (auto controller = dict.getValue<NIFReference>(symbols().controller); controller.ptr; controller = std::get<NIFDictionary>(*controller.ptr).getValue<NIFReference>(symbols().nextController)) {
+			if (std::get<NIFDictionary>(*controller.ptr).kindOf(symbols().niGeomMorpherController)) {
+				morphed = true;
+				break;
+			}
+		}
+
+		bool shared = !skinned && !morphed;
+
+		FbxMesh *mesh = nullptr;
+		if (shared) {
+			auto it = m_sharedMeshes.find(dataPtr);
+			if (it != m_sharedMeshes.end()) {
+				printf("%s: sharing mesh %s\n", node->GetName(), it->second->GetName());
+				mesh = it->second;
+			}
+		}
+
+		if (!mesh) {
+			mesh = importGeometryData(data, node->GetName());
+
+			if (shared) {
+				m_sharedMeshes.emplace(dataPtr, mesh);
+			}
+		}
 
-		auto mesh = FbxMesh::Create(m_scene, (std::string(node->GetName()) + " Mesh").c_str());
 		node->AddNodeAttribute(mesh);
 
 		m_meshesGenerated++;
-		
-		const auto &data = std::get<NIFDictionary>(*dict.getValue<NIFReference>("Data").ptr);
+
+		/*
+		 * Skinning
+		 */
+
+		if (skinned) {
+			auto weights = m_skeleton.skinWeights(skinInstanceRef->ptr.get());
+			if (!weights) {
+				throw std::logic_error("skin instance was not collected by the skeleton processor");
+			}
+
+			bool bonesCreated = true;
+			for (auto boneIndex : weights->boneNodes) {
+				if (boneIndex == SkeletonProcessor::NoNode || !m_nodeMap[boneIndex]) {
+					bonesCreated = false;
+					break;
+				}
+			}
+
+			if (bonesCreated) {
+				importSkin(*weights, mesh);
+			}
+			else {
+				m_deferred.emplace_back([this, weights, mesh]() { importSkin(*weights, mesh); });
+			}
+		}
+	}
+
+	FbxMesh *FBXSceneWriter::importGeometryData(const NIFDictionary &data, const std::string &name) {
+		Symbol symVertices("Vertices");
+		Symbol symVertexColors("Vertex Colors");
+
+		auto mesh = FbxMesh::Create(m_scene, (name + " Mesh").c_str());
 
 		/*
 		 * NiGeometry data
 		 */
 
-		if (data.data.count(symVertices) != 0) {
-			const auto &vertices = data.getValue<NIFArray>(symVertices);
+		if (auto verticesValue = findValue<NIFArray>(data, symVertices)) {
+			const auto &vertices = *verticesValue;
+
+			getVector3Array(vertices, m_componentBuffer);
 
 			mesh->InitControlPoints(static_cast<int>(vertices.data.size()));
 			auto controlPoints = mesh->GetControlPoints();
-			for (size_t index = 0, size = vertices.data.size(); index < size; index++) {
-				controlPoints[index] = getVector3(std::get<NIFDictionary>(vertices.data[index]));
+			const float *components = m_componentBuffer.data();
+			for (size_t index = 0, size = vertices.data.size(); index < size; index++, components += 3) {
+				controlPoints[index].Set(components[0], components[1], components[2]);
 			}
 		}
 
@@ -345,18 +576,24 @@ namespace fbxnif {
 		importVectorElement(data, mesh, "Tangents", &FbxMesh::CreateElementTangent);
 		importVectorElement(data, mesh, "Bitangents", &FbxMesh::CreateElementBinormal);
 
-		if (data.data.count(symVertexColors) != 0) {
-			const auto &vertexColors = data.getValue<NIFArray>(symVertexColors);
+		if (auto vertexColorsValue = findValue<NIFArray>(data, symVertexColors)) {
+			const auto &vertexColors = *vertexColorsValue;
 
 			auto colorElement = mesh->CreateElementVertexColor();
 			colorElement->SetMappingMode(FbxGeometryElement::eByControlPoint);
 			colorElement->SetReferenceMode(FbxGeometryElement::eDirect);
 
+			getColor4Array(vertexColors, m_componentBuffer);
+
 			auto &colorData = colorElement->GetDirectArray();
 			colorData.Resize(static_cast<int>(vertexColors.data.size()));
-			for (size_t index = 0, size = vertexColors.data.size(); index < size; index++) {
-				colorData.SetAt(static_cast<int>(index), getColor4(std::get<NIFDictionary>(vertexColors.data[index])));
+
+			auto colorValues = colorData.GetLocked(FbxLayerElementArray::eWriteLock);
+			const float *components = m_componentBuffer.data();
+			for (size_t index = 0, size = vertexColors.data.size(); index < size; index++, components += 4) {
+				colorValues[index].Set(components[0], components[1], components[2], components[3]);
 			}
+			colorData.Release(&colorValues);
 		}
 
 		const auto &uvSets = data.getValue<NIFArray>("UV Sets");
@@ -370,20 +607,26 @@ namespace fbxnif {
 			uv->SetMappingMode(FbxGeometryElement::eByControlPoint);
 			uv->SetReferenceMode(FbxGeometryElement::eDirect);
 
+			getTexCoordArray(uvSet, m_componentBuffer);
+
 			auto &uvData = uv->GetDirectArray();
 			uvData.Resize(static_cast<int>(uvSet.data.size()));
-			for (size_t index = 0, size = uvSet.data.size(); index < size; index++) {
-				uvData.SetAt(static_cast<int>(index), getTexCoord(std::get<NIFDictionary>(uvSet.data[static_cast<int>(index)])));
+
+			auto uvValues = uvData.GetLocked(FbxLayerElementArray::eWriteLock);
+			const float *components = m_componentBuffer.data();
+			for (size_t index = 0, size = uvSet.data.size(); index < size; index++, components += 2) {
+				uvValues[index].Set(components[0], components[1]);
 			}
+			uvData.Release(&uvValues);
 		}
 
 		/*
 		 * Type-specific data
 		 */
-		if (data.isA("NiTriShapeData")) {
+		if (data.isA(symbols().niTriShapeData)) {
 			importMeshTriangles(mesh, data);
 		}
-		else if (data.isA("NiTriStripsData")) {
+		else if (data.isA(symbols().niTriStripsData)) {
 			importMeshTriangleStrips(mesh, data);
 		}
 		else {
@@ -391,136 +634,118 @@ namespace fbxnif {
 				mesh->GetName(), data.typeChain.front().toString());
 		}
 
-		/*
-		 * Skinning
-		 */
-
-		Symbol symSkinInstance("Skin Instance");
-		if (dict.data.count(symSkinInstance) != 0) {
-			const auto &skinPtr = dict.getValue<NIFReference>(symSkinInstance).ptr;
-			if (skinPtr) {
-				const auto &skinInstance = std::get<NIFDictionary>(*skinPtr);
-				const auto &skinData = std::get<NIFDictionary>(*skinInstance.getValue<NIFReference>("Data").ptr);
-
-				auto skin = FbxSkin::Create(m_scene, (std::string(mesh->GetName()) + " Skin").c_str());
+		return mesh;
+	}
 
-				const auto &skinDataBones = skinData.getValue<NIFArray>("Bone List").data;
-				
-				size_t boneIndex = 0;
-				for (const auto &bone : skinInstance.getValue<NIFArray>("Bones").data) {
-					std::shared_ptr<NIFVariant> bonePtr(std::get<NIFPointer>(bone).ptr);
+	void FBXSceneWriter::importSkin(const SkeletonProcessor::SkinWeights &weights, FbxMesh *mesh) {
+		auto skin = FbxSkin::Create(m_scene, (std::string(mesh->GetName()) + " Skin").c_str());
 
-					auto cluster = FbxCluster::Create(m_scene, "");
+		for (size_t boneIndex = 0, boneCount = weights.boneNodes.size(); boneIndex < boneCount; boneIndex++) {
+			auto nodeIndex = weights.boneNodes[boneIndex];
+			if (nodeIndex == SkeletonProcessor::NoNode || !m_nodeMap[nodeIndex]) {
+				throw std::logic_error("bone is not in the node map");
+			}
 
-					auto it = m_nodeMap.find(bonePtr);
-					if (it == m_nodeMap.end()) {
-						throw std::logic_error("bone is not in the node map");
-					}
+			auto cluster = FbxCluster::Create(m_scene, "");
 
-					cluster->SetLink(it->second);
-					cluster->SetLinkMode(FbxCluster::eTotalOne);
+			cluster->SetLink(m_nodeMap[nodeIndex]);
+			cluster->SetLinkMode(FbxCluster::eTotalOne);
 
-					const auto &boneData = std::get<NIFDictionary>(skinDataBones[boneIndex]);
+			cluster->SetTransformMatrix(weights.skinTransforms[boneIndex]);
 
-					cluster->SetTransformMatrix(
-						getTransform(boneData.getValue<NIFDictionary>("Skin Transform"))
-					);
+			if (weights.rigid) {
+				auto count = mesh->GetControlPointsCount();
 
-					for (const auto &weight : boneData.getValue<NIFArray>("Vertex Weights").data) {
-						const auto &weightDict = std::get<NIFDictionary>(weight);
+				cluster->SetControlPointIWCount(count);
+				auto indices = cluster->GetControlPointIndices();
+				auto values = cluster->GetControlPointWeights();
 
-						cluster->AddControlPointIndex(
-							weightDict.getValue<uint32_t>("Index"),
-							weightDict.getValue<float>("Weight")
-						);
-					}
+				for (int index = 0; index < count; index++) {
+					indices[index] = index;
+					values[index] = 1.0;
+				}
+			}
+			else {
+				auto begin = weights.weightOffsets[boneIndex];
+				auto count = static_cast<int>(weights.weightOffsets[boneIndex + 1] - begin);
 
-					skin->AddCluster(cluster);
+				cluster->SetControlPointIWCount(count);
+				auto indices = cluster->GetControlPointIndices();
+				auto values = cluster->GetControlPointWeights();
 
-					boneIndex++;
+				for (int index = 0; index < count; index++) {
+					indices[index] = static_cast<int>(weights.vertices[begin + index]);
+					values[index] = weights.weights[begin + index];
 				}
-
-				mesh->AddDeformer(skin);
 			}
+
+			skin->AddCluster(cluster);
 		}
+
+		mesh->AddDeformer(skin);
 	}
 	
 	void FBXSceneWriter::importMeshTriangles(FbxMesh *mesh, const NIFDictionary &container) {
 
 		Symbol symTriangles("Triangles");
-		Symbol symV1("v1");
-		Symbol symV2("v2");
-		Symbol symV3("v3");
-
-		if (container.data.count(symTriangles) != 0) {
-			const auto &triangles = container.getValue<NIFArray>(symTriangles);
-
-			mesh->ReservePolygonCount(static_cast<int>(triangles.data.size()));
-			mesh->ReservePolygonVertexCount(static_cast<int>(3 * triangles.data.size()));
 
-			for (const auto &triangleValue : triangles.data) {
-				const auto &triangle = std::get<NIFDictionary>(triangleValue);
+		if (auto trianglesValue = findValue<NIFArray>(container, symTriangles)) {
+			const auto &triangles = *trianglesValue;
 
-				mesh->BeginPolygon(-1, -1, -1, false);
+			getTriangleArray(triangles, m_indexBuffer);
 
-				mesh->AddPolygon(triangle.getValue<uint32_t>(symV1));
-				mesh->AddPolygon(triangle.getValue<uint32_t>(symV2));
-				mesh->AddPolygon(triangle.getValue<uint32_t>(symV3));
-
-				mesh->EndPolygon();
-			}
+			appendTriangles(mesh, m_indexBuffer);
 		}
 	}
 
-	void FBXSceneWriter::importMeshTriangleStrips(FbxMesh *mesh, const NIFDictionary &container) {
-		auto numTriangles = container.getValue<uint32_t>("Num Triangles");
-
-		mesh->ReservePolygonCount(static_cast<int>(numTriangles));
-		mesh->ReservePolygonVertexCount(static_cast<int>(numTriangles * 3));
+	/*
+	 * The polygon tables are only built through the public FbxMesh calls;
+	 * the indices come already decoded in one sweep over the NIF data.
+	 */
+	void FBXSceneWriter::appendTriangles(FbxMesh *mesh, const std::vector<uint32_t> &indices) {
+		auto triangleCount = static_cast<int>(indices.size() / 3);
 
-		if (container.data.count("Strip Lengths") != 0 && container.data.count("Points") != 0) {
-			const auto &stripLengths = container.getValue<NIFArray>("Strip Lengths");
-			const auto &points = container.getValue<NIFArray>("Points");
+		mesh->ReservePolygonCount(mesh->GetPolygonCount() + triangleCount);
+		mesh->ReservePolygonVertexCount(mesh->GetPolygonVertexCount() + triangleCount * 3);
 
-			size_t stripIndex = 0;
+		for (size_t index = 0, size = static_cast<size_t>(triangleCount) * 3; index < size; index += 3) {
+			mesh->BeginPolygon(-1, -1, -1, false);
 
-			for (const auto &stripLengthVal : stripLengths.data) {
-				auto stripLength = std::get<uint32_t>(stripLengthVal);
-				const auto &stripPoints = std::get<NIFArray>(points.data[stripIndex]);
+			mesh->AddPolygon(indices[index]);
+			mesh->AddPolygon(indices[index + 1]);
+			mesh->AddPolygon(indices[index + 2]);
 
-				for (size_t stripPoint = 2; stripPoint < stripLength; stripPoint++) {
+			mesh->EndPolygon();
+		}
+	}
 
-					mesh->BeginPolygon(-1, -1, -1, false);
-					
-					if (stripPoint % 2) {
-						mesh->AddPolygon(std::get<uint32_t>(stripPoints.data[stripPoint]));
-						mesh->AddPolygon(std::get<uint32_t>(stripPoints.data[stripPoint - 1]));
-						mesh->AddPolygon(std::get<uint32_t>(stripPoints.data[stripPoint - 2]));
-					}
-					else {
-						mesh->AddPolygon(std::get<uint32_t>(stripPoints.data[stripPoint - 2]));
-						mesh->AddPolygon(std::get<uint32_t>(stripPoints.data[stripPoint - 1]));
-						mesh->AddPolygon(std::get<uint32_t>(stripPoints.data[stripPoint]));
-					}
+	void FBXSceneWriter::importMeshTriangleStrips(FbxMesh *mesh, const NIFDictionary &container) {
+		auto stripLengthsValue = findValue<NIFArray>(container, "Strip Lengths");
+		auto pointsValue = findValue<NIFArray>(container, "Points");
 
-					mesh->EndPolygon();
-				}
+		if (stripLengthsValue && pointsValue) {
+			unstripTriangles(*stripLengthsValue, *pointsValue, m_indexBuffer);
 
-				stripIndex++;
+			auto numTriangles = container.getValue<uint32_t>("Num Triangles");
+			if (m_indexBuffer.size() / 3 < numTriangles) {
+				printf("%s: %zu degenerate triangles removed from strips\n", mesh->GetName(), numTriangles - m_indexBuffer.size() / 3);
 			}
-		}
 
+			appendTriangles(mesh, m_indexBuffer);
+		}
 	}
 
 	void FBXSceneWriter::convertBSTriShape(const NIFDictionary &dict, fbxsdk::FbxNode *node, Pass pass) {
-		if (pass == Pass::Geometry) {
+		if (includesPass(pass, Pass::Geometry)) {
 
 			auto mesh = FbxMesh::Create(m_scene, (std::string(node->GetName()) + " Mesh").c_str());
 			node->AddNodeAttribute(mesh);
 
 			m_meshesGenerated++;
 
-			auto numVertices = dict.getValue<uint32_t>("Num Vertices");
+			const auto &sym = symbols();
+
+			auto numVertices = dict.getValue<uint32_t>(sym.numVertices);
 
 			mesh->InitControlPoints(static_cast<int>(numVertices));
 
@@ -529,99 +754,68 @@ namespace fbxnif {
 			nifparse::PrettyPrinter prettyPrinter(std::cerr);
 			prettyPrinter.print(vertexAttributes);
 
-			Symbol symVertexData("Vertex Data");
-			Symbol symTriangles("Triangles");
-
-			if (dict.data.count(symVertexData) != 0) {
-				const auto &vertexData = dict.getValue<NIFArray>(symVertexData);
-
-				Symbol symVertex("Vertex");
-				Symbol symUVs("UVs");
-				Symbol symUV("UV");
-				Symbol symNormals("Normals");
-				Symbol symNormal("Normal");
-				Symbol symTangents("Tangents");
-				Symbol symTangent("Tangent");
-				Symbol symBitangentX("Bitangent X");
-				Symbol symBitangentY("Bitangent Y");
-				Symbol symBitangentZ("Bitangent Z");
-				Symbol symVertex_Colors("Vertex_Colors");
-				Symbol symVertexColors("Vertex Colors");
-
-				for (const auto &attribute : vertexAttributes.symbolicValues) {
-					if (attribute == symVertex) {
-						auto controlPoints = mesh->GetControlPoints();
-
-						for (size_t index = 0, size = numVertices; index < size; index++) {
-							controlPoints[index] = getVector3(std::get<NIFDictionary>(vertexData.data[index]).getValue<NIFDictionary>(symVertex));
-						}
-					}
-					else if (attribute == symUVs) {
-						auto uv = mesh->CreateElementUV("UV0", FbxLayerElement::eTextureDiffuse);
-						uv->SetMappingMode(FbxGeometryElement::eByControlPoint);
-						uv->SetReferenceMode(FbxGeometryElement::eDirect);
-
-						auto &uvData = uv->GetDirectArray();
-						uvData.Resize(static_cast<int>(numVertices));
-						for (size_t index = 0; index < numVertices; index++) {
-							uvData.SetAt(static_cast<int>(index), getTexCoord(std::get<NIFDictionary>(vertexData.data[index]).getValue<NIFDictionary>(symUV)));
-						}
+			if (auto vertexDataValue = findValue<NIFArray>(dict, sym.vertexData)) {
+				m_bsVertexDecoder.decode(*vertexDataValue, numVertices, vertexAttributes);
+
+				if (!m_bsVertexDecoder.positions().empty()) {
+					auto controlPoints = mesh->GetControlPoints();
+					const float *components = m_bsVertexDecoder.positions().data();
+					for (size_t index = 0; index < numVertices; index++, components += 3) {
+						controlPoints[index].Set(components[0], components[1], components[2]);
 					}
-					else if (attribute == symNormals) {
-						auto normals = mesh->CreateElementNormal();
-						normals->SetMappingMode(FbxGeometryElement::eByControlPoint);
-						normals->SetReferenceMode(FbxGeometryElement::eDirect);
+				}
 
-						auto &vectorData = normals->GetDirectArray();
-						vectorData.Resize(static_cast<int>(numVertices));
+				if (!m_bsVertexDecoder.uvs().empty()) {
+					auto uv = mesh->CreateElementUV("UV0", FbxLayerElement::eTextureDiffuse);
+					uv->SetMappingMode(FbxGeometryElement::eByControlPoint);
+					uv->SetReferenceMode(FbxGeometryElement::eDirect);
 
-						for (size_t index = 0; index < numVertices; index++) {
-							vectorData.SetAt(static_cast<int>(index), getByteVector3(std::get<NIFDictionary>(vertexData.data[index]).getValue<NIFDictionary>(symNormal)));
-						}
-					}
-					else if (attribute == symTangents) {
-						auto tangents = mesh->CreateElementTangent();
-						tangents->SetMappingMode(FbxGeometryElement::eByControlPoint);
-						tangents->SetReferenceMode(FbxGeometryElement::eDirect);
-
-						auto binormals = mesh->CreateElementBinormal();
-						binormals->SetMappingMode(FbxGeometryElement::eByControlPoint);
-						binormals->SetReferenceMode(FbxGeometryElement::eDirect);
-
-						auto &tangentData = tangents->GetDirectArray();
-						tangentData.Resize(static_cast<int>(numVertices));
-
-						auto &binormalData = binormals->GetDirectArray();
-						binormalData.Resize(static_cast<int>(numVertices));
-
-						for (size_t index = 0; index < numVertices; index++) {
-							const auto &vertex = std::get<NIFDictionary>(vertexData.data[index]);
-
-							tangentData.SetAt(static_cast<int>(index), getByteVector3(vertex.getValue<NIFDictionary>(symTangent)));
-							binormalData.SetAt(static_cast<int>(index), FbxVector4(
-								vertex.getValue<float>(symBitangentX),
-								getSignedFloatFromU8(vertex.getValue<uint32_t>(symBitangentY)),
-								getSignedFloatFromU8(vertex.getValue<uint32_t>(symBitangentZ))
-							));
-						}
+					auto &uvData = uv->GetDirectArray();
+					uvData.Resize(static_cast<int>(numVertices));
+
+					auto uvValues = uvData.GetLocked(FbxLayerElementArray::eWriteLock);
+					const float *components = m_bsVertexDecoder.uvs().data();
+					for (size_t index = 0; index < numVertices; index++, components += 2) {
+						uvValues[index].Set(components[0], components[1]);
 					}
-					else if (attribute == symVertex_Colors) {
-						auto colors = mesh->CreateElementVertexColor();
-						colors->SetMappingMode(FbxGeometryElement::eByControlPoint);
-						colors->SetReferenceMode(FbxGeometryElement::eDirect);
+					uvData.Release(&uvValues);
+				}
 
-						auto &colorData = colors->GetDirectArray();
-						colorData.Resize(static_cast<int>(numVertices));
-						for (size_t index = 0; index < numVertices; index++) {
-							const auto &vertex = std::get<NIFDictionary>(vertexData.data[index]);
+				if (!m_bsVertexDecoder.normals().empty()) {
+					auto normals = mesh->CreateElementNormal();
+					normals->SetMappingMode(FbxGeometryElement::eByControlPoint);
+					normals->SetReferenceMode(FbxGeometryElement::eDirect);
 
-							colorData.SetAt(static_cast<int>(index), getByteColor4(vertex.getValue<NIFDictionary>(symVertexColors)));
-						}
+					setVectorElementData(normals->GetDirectArray(), m_bsVertexDecoder.normals());
+				}
 
+				if (!m_bsVertexDecoder.tangents().empty()) {
+					auto tangents = mesh->CreateElementTangent();
+					tangents->SetMappingMode(FbxGeometryElement::eByControlPoint);
+					tangents->SetReferenceMode(FbxGeometryElement::eDirect);
+
+					auto binormals = mesh->CreateElementBinormal();
+					binormals->SetMappingMode(FbxGeometryElement::eByControlPoint);
+					binormals->SetReferenceMode(FbxGeometryElement::eDirect);
+
+					setVectorElementData(tangents->GetDirectArray(), m_bsVertexDecoder.tangents());
+					setVectorElementData(binormals->GetDirectArray(), m_bsVertexDecoder.bitangents());
+				}
+
+				if (!m_bsVertexDecoder.colors().empty()) {
+					auto colors = mesh->CreateElementVertexColor();
+					colors->SetMappingMode(FbxGeometryElement::eByControlPoint);
+					colors->SetReferenceMode(FbxGeometryElement::eDirect);
+
+					auto &colorData = colors->GetDirectArray();
+					colorData.Resize(static_cast<int>(numVertices));
+
+					auto colorValues = colorData.GetLocked(FbxLayerElementArray::eWriteLock);
+					const float *components = m_bsVertexDecoder.colors().data();
+					for (size_t index = 0; index < numVertices; index++, components += 4) {
+						colorValues[index].Set(components[0], components[1], components[2], components[3]);
 					}
-					else {
-						fprintf(stderr, "Unsupported vertex attribute: %s\n", attribute.toString());
-					}
+					colorData.Release(&colorValues);
 				}
 			}
 
@@ -639,11 +833,13 @@ namespace fbxnif {
 
 	template<typename PropertyType>
 	void FBXSceneWriter::generateCurves(const NIFDictionary &keyGroup, FbxPropertyT<PropertyType> &prop, FbxAnimLayer *layer, CurveGenerationMode mode, FbxAnimCurveNode *&node) {
-		auto numKeys = keyGroup.getValue<uint32_t>("Num Keys");
+		const auto &sym = symbols();
+
+		auto numKeys = keyGroup.getValue<uint32_t>(sym.numKeys);
 		if (numKeys > 0) {
 
-			const auto &interpolation = keyGroup.getValue<NIFEnum>("Interpolation");
-			const auto &keys = keyGroup.getValue<NIFArray>("Keys");
+			const auto &interpolation = keyGroup.getValue<NIFEnum>(sym.interpolation);
+			const auto &keys = keyGroup.getValue<NIFArray>(sym.keys);
 
 			generateCurves(interpolation, keys, prop, layer, mode, node);
 		}
@@ -651,6 +847,10 @@ namespace fbxnif {
 
 	template<typename PropertyType>
 	void FBXSceneWriter::generateCurves(const NIFEnum &interpolation, const NIFArray &keys, FbxPropertyT<PropertyType> &prop, FbxAnimLayer *layer, CurveGenerationMode mode, FbxAnimCurveNode *&node) {
+		const auto &sym = symbols();
+		bool tbcInterpolation = interpolation.symbolicValue == sym.tbcKey;
+		bool quadraticInterpolation = interpolation.symbolicValue == sym.quadraticKey;
+
 		if (!node) {
 			node = prop.CreateCurveNode(layer);
 		}
@@ -696,42 +896,42 @@ namespace fbxnif {
 			const auto &key = std::get<NIFDictionary>(keyVal);
 
 			FbxTime time;
-			time.SetSecondDouble(key.getValue<float>("Time"));
+			time.SetSecondDouble(key.getValue<float>(sym.time));
 
 			if (mode == CurveGenerationMode::Translation) {
-				const auto &value = getVector3(key.getValue<NIFDictionary>("Value"));
+				const auto &value = getVector3(key.getValue<NIFDictionary>(sym.value));
 
 				FbxAnimCurveKey xKey;
 				FbxAnimCurveKey yKey;
 				FbxAnimCurveKey zKey;
 
-				if (interpolation.symbolicValue == Symbol("TBC_KEY")) {
-					const auto &tbc = key.getValue<NIFDictionary>("TBC");
+				if (tbcInterpolation) {
+					const auto &tbc = key.getValue<NIFDictionary>(sym.tbc);
 
 					xKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					xKey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					xKey.SetTCB(time, static_cast<float>(value[0]),
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 
 					yKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					yKey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					yKey.SetTCB(time, static_cast<float>(value[1]),
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 
 					zKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					zKey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					zKey.SetTCB(time, static_cast<float>(value[2]),
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 				}
-				else if (interpolation.symbolicValue == Symbol("QUADRATIC_KEY")) {
-					const auto &ftangent = getVector3(key.getValue<NIFDictionary>("Forward"));
-					const auto &btangent = getVector3(key.getValue<NIFDictionary>("Backward"));
+				else if (quadraticInterpolation) {
+					const auto &ftangent = getVector3(key.getValue<NIFDictionary>(sym.forward));
+					const auto &btangent = getVector3(key.getValue<NIFDictionary>(sym.backward));
 
 					xKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					xKey.SetTangentMode(FbxAnimCurveDef::eTangentUser);
@@ -762,7 +962,7 @@ namespace fbxnif {
 				curves[2]->KeyAdd(time, zKey);
 			}
 			else if (mode == CurveGenerationMode::Scaling || mode == CurveGenerationMode::RotationX || mode == CurveGenerationMode::RotationY || mode == CurveGenerationMode::RotationZ) {
-				auto value = key.getValue<float>("Value");
+				auto value = key.getValue<float>(sym.value);
 
 				if (mode == CurveGenerationMode::RotationX || mode == CurveGenerationMode::RotationY || mode == CurveGenerationMode::RotationZ) {
 					value *= static_cast<float>(FBXSDK_180_DIV_PI);
@@ -770,20 +970,20 @@ namespace fbxnif {
 
 				FbxAnimCurveKey skey;
 
-				if (interpolation.symbolicValue == Symbol("TBC_KEY")) {
-					const auto &tbc = key.getValue<NIFDictionary>("TBC");
+				if (tbcInterpolation) {
+					const auto &tbc = key.getValue<NIFDictionary>(sym.tbc);
 
 					skey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					skey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					skey.SetTCB(time, value,
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 
 				}
-				else if (interpolation.symbolicValue == Symbol("QUADRATIC_KEY")) {
-					auto ftangent = key.getValue<float>("Forward");
-					auto btangent = key.getValue<float>("Backward");
+				else if (quadraticInterpolation) {
+					auto ftangent = key.getValue<float>(sym.forward);
+					auto btangent = key.getValue<float>(sym.backward);
 
 					skey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					skey.SetTangentMode(FbxAnimCurveDef::eTangentUser);
@@ -799,35 +999,35 @@ namespace fbxnif {
 			}
 			else if (mode == CurveGenerationMode::RotationQuaternion) {
 				FbxVector4 rotation;
-				rotation.SetXYZ(getQuaternion(key.getValue<NIFDictionary>("Value")));
+				rotation.SetXYZ(getQuaternion(key.getValue<NIFDictionary>(sym.value)));
 
 				FbxAnimCurveKey xKey;
 				FbxAnimCurveKey yKey;
 				FbxAnimCurveKey zKey;
 
-				if (interpolation.symbolicValue == Symbol("TBC_KEY")) {
-					const auto &tbc = key.getValue<NIFDictionary>("TBC");
+				if (tbcInterpolation) {
+					const auto &tbc = key.getValue<NIFDictionary>(sym.tbc);
 
 					xKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					xKey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					xKey.SetTCB(time, static_cast<float>(rotation[0]),
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 
 					yKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					yKey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					yKey.SetTCB(time, static_cast<float>(rotation[1]),
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 
 					zKey.SetInterpolation(FbxAnimCurveDef::eInterpolationCubic);
 					zKey.SetTangentMode(FbxAnimCurveDef::eTangentTCB);
 					zKey.SetTCB(time, static_cast<float>(rotation[2]),
-						tbc.getValue<float>("t"),
-						tbc.getValue<float>("c"),
-						tbc.getValue<float>("b"));
+						tbc.getValue<float>(sym.t),
+						tbc.getValue<float>(sym.c),
+						tbc.getValue<float>(sym.b));
 				}
 				else { // LINEAR_KEY and any others
 					xKey.Set(time, static_cast<float>(rotation[0]));
@@ -865,7 +1065,7 @@ namespace fbxnif {
 
 			FbxAnimCurveNode *rotationNode = nullptr;
 
-			if (rotationType.symbolicValue == Symbol("XYZ_ROTATION_KEY")) {
+			if (rotationType.symbolicValue == symbols().xyzRotationKey) {
 				auto &rotations = dataDict.getValue<NIFArray>("XYZ Rotations");
 
 				generateCurves(std::get<NIFDictionary>(rotations.data[0]), node->LclRotation, layer, CurveGenerationMode::RotationX, rotationNode);
@@ -1023,129 +1223,149 @@ namespace fbxnif {
 	}
 
 	void FBXSceneWriter::processController(const NIFDictionary &controller, FbxNode *node) {
-		if (controller.kindOf("NiKeyframeController")) {
-			printf("Keyframe controller on %s\n", node->GetName());
+		if (auto handler = m_controllerHandlers.find(controller)) {
+			(*handler)(controller, node);
+		}
+		else {
+			fprintf(stderr, "unsupported controller of type %s on node %s\n", controller.typeChain.front().toString(), node->GetName());
+		}
+	}
 
-			if (controller.data.count("Interpolator") != 0) {
-				const auto &interpolatorPtr = controller.getValue<NIFReference>("Interpolator");
-				if (!interpolatorPtr.ptr) {
-					fprintf(stderr, "Keyframe controller on %s has no interpolator\n", node->GetName());
+	void FBXSceneWriter::processKeyframeController(const NIFDictionary &controller, FbxNode *node) {
+		printf("Keyframe controller on %s\n", node->GetName());
 
-					return;
-				}
+		if (auto interpolatorValue = findValue<NIFReference>(controller, "Interpolator")) {
+			const auto &interpolatorPtr = *interpolatorValue;
+			if (!interpolatorPtr.ptr) {
+				fprintf(stderr, "Keyframe controller on %s has no interpolator\n", node->GetName());
 
-				const auto &interpolator = std::get<NIFDictionary>(*interpolatorPtr.ptr);
+				return;
+			}
 
-				if (interpolator.kindOf("NiTransformInterpolator")) {
-					const auto &data = interpolator.getValue<NIFReference>("Data");
+			const auto &interpolator = std::get<NIFDictionary>(*interpolatorPtr.ptr);
 
-					if (!data.ptr) {
-						applyInterpolatorTransform(interpolator, node);
-					}
-					else {
-						processKeyframeAnimation(data, node);
-					}
-				} else if(interpolator.kindOf("NiBSplineInterpolator")) {
-					processBSplineAnimation(interpolator, node);
-				} else {
-					fprintf(stderr, "Unsupported interpolator on NiKeyframeController: %s\n", interpolator.typeChain.front().toString());
-					return;
+			if (interpolator.kindOf(symbols().niTransformInterpolator)) {
+				const auto &data = interpolator.getValue<NIFReference>("Data");
+
+				if (!data.ptr) {
+					applyInterpolatorTransform(interpolator, node);
 				}
-			}
-			else {
-				const auto &data = controller.getValue<NIFReference>("Data");
-				if (data.ptr) {
+				else {
 					processKeyframeAnimation(data, node);
 				}
+			} else if(interpolator.kindOf(symbols().niBSplineInterpolator)) {
+				processBSplineAnimation(interpolator, node);
+			} else {
+				fprintf(stderr, "Unsupported interpolator on NiKeyframeController: %s\n", interpolator.typeChain.front().toString());
+				return;
+			}
+		}
+		else {
+			const auto &data = controller.getValue<NIFReference>("Data");
+			if (data.ptr) {
+				processKeyframeAnimation(data, node);
 			}
+		}
+	}
 
+	void FBXSceneWriter::processControllerManager(const NIFDictionary &controller, FbxNode *node) {
+		if (m_singlePass) {
+			// Sequences look their targets up by name, and those may not have been created yet
+			m_deferred.emplace_back([this, &controller]() { processControllerSequences(controller); });
+		}
+		else {
+			processControllerSequences(controller);
+		}
+	}
 
-		} else if(controller.kindOf("NiControllerManager")) {
-			printf("NiControllerManager found, deferring\n");
+	void FBXSceneWriter::processControllerSequences(const NIFDictionary &controller) {
+		printf("NiControllerManager found, deferring\n");
 
-			const auto &palette = controller.getValue<NIFReference>("Object Palette");
-			const auto &sequences = controller.getValue<NIFArray>("Controller Sequences");
+		const auto &palette = controller.getValue<NIFReference>("Object Palette");
+		const auto &sequences = controller.getValue<NIFArray>("Controller Sequences");
 
-			for (const auto &obj : sequences.data) {
-				const auto &ref = std::get<NIFReference>(obj);
+		for (const auto &obj : sequences.data) {
+			const auto &ref = std::get<NIFReference>(obj);
 
-				if (ref.ptr) {
-					processControllerSequence(std::get<NIFDictionary>(*ref.ptr), palette);
-				}
+			if (ref.ptr) {
+				processControllerSequence(std::get<NIFDictionary>(*ref.ptr), palette);
 			}
 		}
-		else if (controller.kindOf("NiGeomMorpherController")) {
-			printf("Morpher controller on %s\n", node->GetName());
+	}
 
-			auto mesh = node->GetMesh();
-			if (!mesh) {
-				fprintf(stderr, "node %s has GeomMorpherController, but no mesh could be retrived\n", node->GetName());
-				return;
-			}
+	void FBXSceneWriter::processGeomMorpherController(const NIFDictionary &controller, FbxNode *node) {
+		printf("Morpher controller on %s\n", node->GetName());
+
+		auto mesh = node->GetMesh();
+		if (!mesh) {
+			fprintf(stderr, "node %s has GeomMorpherController, but no mesh could be retrived\n", node->GetName());
+			return;
+		}
+
+		const auto &dataRef = controller.getValue<NIFReference>("Data");
+		const auto &dataDict = std::get<NIFDictionary>(*dataRef.ptr);
 
-			const auto &dataRef = controller.getValue<NIFReference>("Data");
-			const auto &dataDict = std::get<NIFDictionary>(*dataRef.ptr);
+		auto blendShape = static_cast<FbxBlendShape *>(mesh->GetDeformer(0, FbxDeformer::eBlendShape));
+		if (blendShape) {
+			printf("blend shape already exists\n");
+		}
+		else {
+			blendShape = FbxBlendShape::Create(m_scene, "");				
+			mesh->AddDeformer(blendShape);
 
-			auto blendShape = static_cast<FbxBlendShape *>(mesh->GetDeformer(0, FbxDeformer::eBlendShape));
-			if (blendShape) {
-				printf("blend shape already exists\n");
+			auto relative = dataDict.getValue<uint32_t>("Relative Targets");
+			auto vertexCount = dataDict.getValue<uint32_t>("Num Vertices");
+			if (vertexCount != mesh->GetControlPointsCount()) {
+				throw std::logic_error("vertex count mismatch between morph and its base shape");
 			}
-			else {
-				blendShape = FbxBlendShape::Create(m_scene, "");				
-				mesh->AddDeformer(blendShape);
 
-				auto relative = dataDict.getValue<uint32_t>("Relative Targets");
-				auto vertexCount = dataDict.getValue<uint32_t>("Num Vertices");
-				if (vertexCount != mesh->GetControlPointsCount()) {
-					throw std::logic_error("vertex count mismatch between morph and its base shape");
-				}
+			auto baseControlPoints = mesh->GetControlPoints();
 
-				auto baseControlPoints = mesh->GetControlPoints();
+			bool first = true;
 
-				bool first = true;
+			for (const auto &morphValue : dataDict.getValue<NIFArray>("Morphs").data) {
+				if (first) {
+					first = false;
+					continue;
+				}
 
-				for (const auto &morphValue : dataDict.getValue<NIFArray>("Morphs").data) {
-					if (first) {
-						first = false;
-						continue;
-					}
+				const auto &morph = std::get<NIFDictionary>(morphValue);
 
-					const auto &morph = std::get<NIFDictionary>(morphValue);
+				std::string name;
 
-					std::string name;
+				if (auto frameName = findValue<NIFDictionary>(morph, "Frame Name")) {
+					name = getString(*frameName, m_file.header());
+				}
 
-					if (morph.data.count("Frame Name")) {
-						name = getString(morph.getValue<NIFDictionary>("Frame Name"), m_file.header());
-					}
+				const auto &vectors = morph.getValue<NIFArray>("Vectors");
 
-					const auto &vectors = morph.getValue<NIFArray>("Vectors");
+				auto channel = FbxBlendShapeChannel::Create(m_scene, name.c_str());
+				blendShape->AddBlendShapeChannel(channel);
 
-					auto channel = FbxBlendShapeChannel::Create(m_scene, name.c_str());
-					blendShape->AddBlendShapeChannel(channel);
+				auto shape = FbxShape::Create(m_scene, "");
+				channel->AddTargetShape(shape);
 
-					auto shape = FbxShape::Create(m_scene, "");
-					channel->AddTargetShape(shape);
+				shape->InitControlPoints(vertexCount);
+				auto shapeControlPoints = shape->GetControlPoints();
 
-					shape->InitControlPoints(vertexCount);
-					auto shapeControlPoints = shape->GetControlPoints();
+				getVector3Array(vectors, m_componentBuffer);
+				if (m_componentBuffer.size() < static_cast<size_t>(vertexCount) * 3) {
+					throw std::logic_error("morph has fewer vectors than its base shape has vertices");
+				}
 
-					for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
-						auto vector = getVector3(std::get<NIFDictionary>(vectors.data[vertex]));
+				for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+					const float *components = &m_componentBuffer[vertex * 3];
+					FbxVector4 vector(components[0], components[1], components[2]);
 
-						if (relative) {
-							shapeControlPoints[vertex] = baseControlPoints[vertex] + vector;
-						}
-						else {
-							shapeControlPoints[vertex] = vector;
-						}
+					if (relative) {
+						shapeControlPoints[vertex] = baseControlPoints[vertex] + vector;
+					}
+					else {
+						shapeControlPoints[vertex] = vector;
 					}
-
 				}
-			}
 
-		}
-		else {
-			fprintf(stderr, "unsupported controller of type %s on node %s\n", controller.typeChain.front().toString(), node->GetName());
+			}
 		}
 	}
 
@@ -1177,9 +1397,9 @@ namespace fbxnif {
 
 		auto stack = FbxAnimStack::Create(m_scene, sequenceName.c_str());
 
-		if (sequence.data.count("Start Time") != 0) {
+		if (auto startTimeValue = findValue<float>(sequence, "Start Time")) {
 			FbxTime startTime;
-			startTime.SetSecondDouble(sequence.getValue<float>("Start Time"));
+			startTime.SetSecondDouble(*startTimeValue);
 
 			FbxTime stopTime;
 			stopTime.SetSecondDouble(sequence.getValue<float>("Stop Time"));
@@ -1200,25 +1420,28 @@ namespace fbxnif {
 
 			NIFReference palette;
 
-			if (blockDict.data.count("String Palette") != 0) {
-				palette = blockDict.getValue<NIFReference>("String Palette");
+			if (auto paletteValue = findValue<NIFReference>(blockDict, "String Palette")) {
+				palette = *paletteValue;
 			}
 
-			std::string targetNode;
+			std::string targetNodeString;
+			std::string_view targetNode;
 
-			if (blockDict.data.count("Target Name") != 0) {
-				targetNode = getString(blockDict.getValue<NIFDictionary>("Target Name"), m_file.header());
+			if (auto targetName = findValue<NIFDictionary>(blockDict, "Target Name")) {
+				targetNodeString = getString(*targetName, m_file.header());
+				targetNode = targetNodeString;
 			}
-			else if (blockDict.data.count("Node Name Offset") != 0) {
-				targetNode = getStringFromPalette(blockDict.getValue<uint32_t>("Node Name Offset"), std::get<NIFDictionary>(*palette.ptr));
+			else if (auto nodeNameOffset = findValue<uint32_t>(blockDict, "Node Name Offset")) {
+				targetNode = getStringFromPalette(*nodeNameOffset, std::get<NIFDictionary>(*palette.ptr));
 			}
 			else {
-				targetNode = getString(blockDict.getValue<NIFDictionary>("Node Name"), m_file.header());				
+				targetNodeString = getString(blockDict.getValue<NIFDictionary>("Node Name"), m_file.header());
+				targetNode = targetNodeString;
 			}
 
-			auto node = m_scene->FindNodeByName(targetNode.c_str());
+			auto node = findNodeByName(targetNode);
 			if (!node) {
-				fprintf(stderr, "Node %s, required by NiSequence, is not present\n", targetNode.c_str());
+				fprintf(stderr, "Node %.*s, required by NiSequence, is not present\n", static_cast<int>(targetNode.size()), targetNode.data());
 				continue;
 			}
 
@@ -1229,8 +1452,8 @@ namespace fbxnif {
 			else {
 				std::string controllerTypeName;
 
-				if (blockDict.data.count("Controller Type Offset") != 0) {
-					controllerTypeName = getStringFromPalette(blockDict.getValue<uint32_t>("Controller Type Offset"), std::get<NIFDictionary>(*palette.ptr));
+				if (auto controllerTypeOffset = findValue<uint32_t>(blockDict, "Controller Type Offset")) {
+					controllerTypeName = std::string(getStringFromPalette(*controllerTypeOffset, std::get<NIFDictionary>(*palette.ptr)));
 				}
 				else {
 					controllerTypeName = getString(blockDict.getValue<NIFDictionary>("Controller Type"), m_file.header());
@@ -1257,211 +1480,457 @@ namespace fbxnif {
 
 	FbxSurfaceMaterial *FBXSceneWriter::establishMaterial(FbxNode *node) {
 		if (node->GetMaterialCount() == 0) {
-			auto material = fbxsdk::FbxSurfacePhong::Create(m_scene, FbxString(node->GetName()) + " Material");
-			node->AddMaterial(material);
-
-			auto mesh = node->GetMesh();
-			if (mesh) {
-				auto materialElement = mesh->CreateElementMaterial();
-				materialElement->SetMappingMode(fbxsdk::FbxLayerElement::eAllSame);
-				materialElement->GetIndexArray().Add(0);
-			}
+			attachMaterial(node, fbxsdk::FbxSurfacePhong::Create(m_scene, FbxString(node->GetName()) + " Material"));
 		}
 
 		return node->GetMaterial(0);
 	}
 
+	void FBXSceneWriter::attachMaterial(FbxNode *node, FbxSurfaceMaterial *material) {
+		node->AddMaterial(material);
+
+		auto mesh = node->GetMesh();
+		if (mesh && mesh->GetElementMaterialCount() == 0) {
+			auto materialElement = mesh->CreateElementMaterial();
+			materialElement->SetMappingMode(fbxsdk::FbxLayerElement::eAllSame);
+			materialElement->GetIndexArray().Add(0);
+		}
+	}
+
 	template<typename Functor>
 	void FBXSceneWriter::manipulateExtendedMaterialData(FbxSurfaceMaterial *material, Functor &&functor) {
+		auto &extendedData = m_extendedMaterialData[material];
 
-		Json::Value extendedData(Json::objectValue);
+		if (!extendedData) {
+			extendedData = std::make_unique<Json::Value>(Json::objectValue);
 
-		auto extendedDataProp = material->FindProperty("ExtendedMaterialData");
-		if (extendedDataProp.IsValid()) {
-			Json::CharReaderBuilder readerBuilder;
-			std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+			auto extendedDataProp = material->FindProperty("ExtendedMaterialData");
+			if (extendedDataProp.IsValid()) {
+				Json::CharReaderBuilder readerBuilder;
+				std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
 
-			auto val = extendedDataProp.Get<FbxString>();
+				auto val = extendedDataProp.Get<FbxString>();
 
-			if (!reader->parse(val, static_cast<const char *>(val) + val.Size(), &extendedData, nullptr))
-				throw std::logic_error("failed to parse ExtendedMaterialData");
-		}
-		else {
-			extendedDataProp = FbxProperty::Create(material, FbxStringDT, "ExtendedMaterialData");
+				if (!reader->parse(val, static_cast<const char *>(val) + val.Size(), extendedData.get(), nullptr))
+					throw std::logic_error("failed to parse ExtendedMaterialData");
+			}
 		}
 
-		functor(extendedData);
+		functor(*extendedData);
+	}
 
+	void FBXSceneWriter::writeExtendedMaterialData() {
 		Json::StreamWriterBuilder writerBuilder;
 		writerBuilder["indentation"] = "";
 		std::unique_ptr<Json::StreamWriter> writer(writerBuilder.newStreamWriter());
 		std::stringstream writeStream;
-		writer->write(extendedData, &writeStream);
-		extendedDataProp.Set<FbxString>(writeStream.str().c_str());
+
+		for (const auto &entry : m_extendedMaterialData) {
+			auto extendedDataProp = entry.first->FindProperty("ExtendedMaterialData");
+			if (!extendedDataProp.IsValid()) {
+				extendedDataProp = FbxProperty::Create(entry.first, FbxStringDT, "ExtendedMaterialData");
+			}
+
+			writeStream.str(std::string());
+			writer->write(*entry.second, &writeStream);
+			extendedDataProp.Set<FbxString>(writeStream.str().c_str());
+		}
+
+		m_extendedMaterialData.clear();
+	}
+
+	void FBXSceneWriter::processProperties(const NIFDictionary &dict, FbxNode *node, Pass pass) {
+		auto properties = findValue<NIFArray>(dict, symbols().properties);
+		if (!properties)
+			return;
+
+		/*
+		 * Nodes with the same property blocks and vertex color state get the
+		 * same material, which is only built for the first of them. Other
+		 * property handlers still run for every node.
+		 */
+		MaterialKey materialKey;
+		bool buildingMaterial = false;
+
+		if (includesPass(pass, Pass::Geometry) && node->GetMaterialCount() == 0) {
+			auto &propertyPointers = std::get<0>(materialKey);
+			propertyPointers.reserve(properties->data.size());
+			for (const auto &prop : properties->data) {
+				propertyPointers.push_back(std::get<NIFReference>(prop).ptr.get());
+			}
+
+			std::get<1>(materialKey) = m_vertexColorVertexMode;
+			std::get<2>(materialKey) = m_vertexColorLightingMode;
+
+			auto it = m_materialCache.find(materialKey);
+			if (it != m_materialCache.end()) {
+				attachMaterial(node, it->second);
+				m_reusingMaterial = true;
+			}
+			else {
+				buildingMaterial = true;
+			}
+		}
+
+		for (const auto &prop : properties->data) {
+			const auto &ptr = std::get<NIFReference>(prop).ptr;
+			if (ptr) {
+				processProperty(std::get<NIFDictionary>(*ptr), node, pass);
+			}
+		}
+
+		m_reusingMaterial = false;
+
+		if (buildingMaterial && node->GetMaterialCount() != 0) {
+			m_materialCache.emplace(std::move(materialKey), node->GetMaterial(0));
+		}
 	}
 
 	void FBXSceneWriter::processProperty(const NIFDictionary &prop, FbxNode *node, Pass pass) {
 		printf("Property %s on %s\n", prop.typeChain.front().toString(), node->GetName());
 
-		if (prop.kindOf("NiMaterialProperty")) {
-			if (pass == Pass::Geometry) {
-				auto material = static_cast<fbxsdk::FbxSurfacePhong *>(establishMaterial(node));
+		if (auto handler = m_propertyHandlers.find(prop)) {
+			(*handler)(prop, node, pass);
+		}
+		else {
+			fprintf(stderr, "Unsupported property: '%s' on %s\n", prop.typeChain.front().toString(), node->GetName());
+		}
 
-				manipulateExtendedMaterialData(material, [&](Json::Value &extendedData) {
-					extendedData["VertexColorMode"] = m_vertexColorVertexMode;
-					extendedData["VertexLightingMode"] = m_vertexColorLightingMode;
-					extendedData["Model"] = "PreShader";
+		if (includesPass(pass, Pass::Animation)) {
+			for (auto controller = prop.getValue<NIFReference>("Controller"); controller.ptr; controller = std::get<NIFDictionary>(*controller.ptr).getValue<NIFReference>("Next Controller")) {
+				processController(std::get<NIFDictionary>(*controller.ptr), node);
+			}
+		}
+	}
 
-					if (prop.data.count("Ambient Color") != 0) {
-						extendedData["AmbientColor"] = toJsonValue(getColor3(prop.getValue<NIFDictionary>("Ambient Color")));
-					}
+	void FBXSceneWriter::processMaterialProperty(const NIFDictionary &prop, FbxNode *node, Pass pass) {
+		if (includesPass(pass, Pass::Geometry) && !m_reusingMaterial) {
+			auto material = static_cast<fbxsdk::FbxSurfacePhong *>(establishMaterial(node));
 
-					if (prop.data.count("Diffuse Color") != 0) {
-						auto diffuseColor = getColor3(prop.getValue<NIFDictionary>("Diffuse Color"));
+			manipulateExtendedMaterialData(material, [&](Json::Value &extendedData) {
+				extendedData["VertexColorMode"] = m_vertexColorVertexMode;
+				extendedData["VertexLightingMode"] = m_vertexColorLightingMode;
+				extendedData["Model"] = "PreShader";
 
-						extendedData["DiffuseColor"] = toJsonValue(diffuseColor);
-						material->Diffuse.Set(diffuseColor);
-					}
-					
-					auto specularColor = getColor3(prop.getValue<NIFDictionary>("Specular Color"));
-					extendedData["SpecularColor"] = toJsonValue(specularColor);
-					material->Specular.Set(specularColor);
-
-					auto emissiveColor = getColor3(prop.getValue<NIFDictionary>("Emissive Color"));
-					extendedData["EmissiveColor"] = toJsonValue(emissiveColor);
-					material->Emissive.Set(emissiveColor);
-
-					auto glossiness = prop.getValue<float>("Glossiness");
-					extendedData["Glossiness"] = static_cast<double>(glossiness);
-					material->Shininess.Set(glossiness);
-
-					auto alpha = prop.getValue<float>("Alpha");
-					extendedData["Alpha"] = static_cast<double>(alpha);
-					material->TransparencyFactor.Set(alpha);
-
-					if (prop.data.count("Emissive Mult") != 0) {
-						auto emissiveMult = prop.getValue<float>("Emissive Mult");
-						extendedData["EmissiveMult"] = emissiveMult;
-						material->EmissiveFactor.Set(emissiveMult);
-					}
-				});
-			}
+				if (auto ambientColor = findValue<NIFDictionary>(prop, "Ambient Color")) {
+					extendedData["AmbientColor"] = toJsonValue(getColor3(*ambientColor));
+				}
+
+				if (auto diffuseColorValue = findValue<NIFDictionary>(prop, "Diffuse Color")) {
+					auto diffuseColor = getColor3(*diffuseColorValue);
+
+					extendedData["DiffuseColor"] = toJsonValue(diffuseColor);
+					material->Diffuse.Set(diffuseColor);
+				}
+				
+				auto specularColor = getColor3(prop.getValue<NIFDictionary>("Specular Color"));
+				extendedData["SpecularColor"] = toJsonValue(specularColor);
+				material->Specular.Set(specularColor);
+
+				auto emissiveColor = getColor3(prop.getValue<NIFDictionary>("Emissive Color"));
+				extendedData["EmissiveColor"] = toJsonValue(emissiveColor);
+				material->Emissive.Set(emissiveColor);
+
+				auto glossiness = prop.getValue<float>("Glossiness");
+				extendedData["Glossiness"] = static_cast<double>(glossiness);
+				material->Shininess.Set(glossiness);
+
+				auto alpha = prop.getValue<float>("Alpha");
+				extendedData["Alpha"] = static_cast<double>(alpha);
+				material->TransparencyFactor.Set(alpha);
+
+				if (auto emissiveMultValue = findValue<float>(prop, "Emissive Mult")) {
+					auto emissiveMult = *emissiveMultValue;
+					extendedData["EmissiveMult"] = emissiveMult;
+					material->EmissiveFactor.Set(emissiveMult);
+				}
+			});
 		}
-		else if (prop.kindOf("NiTexturingProperty")) {
-			if (pass == Pass::Geometry) {
-				auto material = static_cast<fbxsdk::FbxSurfacePhong *>(establishMaterial(node));
+	}
 
-				manipulateExtendedMaterialData(material, [&](Json::Value &extendedData) {
-					extendedData["ApplyMode"] = prop.getValue<NIFEnum>("Apply Mode").symbolicValue.toString();
-					Json::Value textures(Json::objectValue);
+	void FBXSceneWriter::processTexturingProperty(const NIFDictionary &prop, FbxNode *node, Pass pass) {
+		if (includesPass(pass, Pass::Geometry) && !m_reusingMaterial) {
+			auto material = static_cast<fbxsdk::FbxSurfacePhong *>(establishMaterial(node));
 
-					if (prop.getValue<uint32_t>("Has Base Texture")) {
-						textures["Base"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Base Texture"));
-					}
+			manipulateExtendedMaterialData(material, [&](Json::Value &extendedData) {
+				extendedData["ApplyMode"] = prop.getValue<NIFEnum>("Apply Mode").symbolicValue.toString();
+				Json::Value textures(Json::objectValue);
 
-					if (prop.getValue<uint32_t>("Has Dark Texture")) {
-						textures["Dark"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Dark Texture"));
-					}
+				if (prop.getValue<uint32_t>("Has Base Texture")) {
+					textures["Base"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Base Texture"));
+				}
 
-					if (prop.getValue<uint32_t>("Has Detail Texture")) {
-						textures["Detail"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Detail Texture"));
-					}
+				if (prop.getValue<uint32_t>("Has Dark Texture")) {
+					textures["Dark"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Dark Texture"));
+				}
 
-					if (prop.getValue<uint32_t>("Has Gloss Texture")) {
-						textures["Gloss"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Gloss Texture"));
-					}				
-					
-					if (prop.getValue<uint32_t>("Has Glow Texture")) {
-						textures["Glow"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Glow Texture"));
-					}
+				if (prop.getValue<uint32_t>("Has Detail Texture")) {
+					textures["Detail"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Detail Texture"));
+				}
 
-					if (prop.data.count("Has Bump Map Texture") && prop.getValue<uint32_t>("Has Bump Map Texture")) {
-						textures["BumpMap"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Bump Map Texture"));
-						extendedData["BumpMapLumaScale"] = static_cast<double>(prop.getValue<float>("Bump Map Luma Scale"));
-						extendedData["BumpMapLumaOffset"] = static_cast<double>(prop.getValue<float>("Bump Map Luma Offset"));
-						extendedData["BumpMapMatrix"] = toJsonValue(getMatrix2x2(prop.getValue<NIFDictionary>("Bump Map Matrix")));
-					}
+				if (prop.getValue<uint32_t>("Has Gloss Texture")) {
+					textures["Gloss"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Gloss Texture"));
+				}				
+				
+				if (prop.getValue<uint32_t>("Has Glow Texture")) {
+					textures["Glow"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Glow Texture"));
+				}
 
-					if (prop.data.count("Has Normal Texture") && prop.getValue<uint32_t>("Has Normal Texture")) {
-						textures["Normal"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Normal Texture"));
-					}
+				if (hasFlag(prop, "Has Bump Map Texture")) {
+					textures["BumpMap"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Bump Map Texture"));
+					extendedData["BumpMapLumaScale"] = static_cast<double>(prop.getValue<float>("Bump Map Luma Scale"));
+					extendedData["BumpMapLumaOffset"] = static_cast<double>(prop.getValue<float>("Bump Map Luma Offset"));
+					extendedData["BumpMapMatrix"] = toJsonValue(getMatrix2x2(prop.getValue<NIFDictionary>("Bump Map Matrix")));
+				}
 
-					if (prop.data.count("Has Parallax Texture") && prop.getValue<uint32_t>("Has Parallax Texture")) {
-						textures["Parallax"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Parallax Texture"));
-						extendedData["ParallaxOffset"] = static_cast<double>(prop.getValue<float>("Parallax Offset"));
-					}
+				if (hasFlag(prop, "Has Normal Texture")) {
+					textures["Normal"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Normal Texture"));
+				}
 
-					if (prop.data.count("Has Decal 0 Texture") && prop.getValue<uint32_t>("Has Decal 0 Texture")) {
-						textures["Decal0"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 0 Texture"));
-					}
+				if (hasFlag(prop, "Has Parallax Texture")) {
+					textures["Parallax"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Parallax Texture"));
+					extendedData["ParallaxOffset"] = static_cast<double>(prop.getValue<float>("Parallax Offset"));
+				}
 
-					if (prop.data.count("Has Decal 1 Texture") && prop.getValue<uint32_t>("Has Decal 1 Texture")) {
-						textures["Decal1"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 1 Texture"));
-					}
+				if (hasFlag(prop, "Has Decal 0 Texture")) {
+					textures["Decal0"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 0 Texture"));
+				}
 
-					if (prop.data.count("Has Decal 2 Texture") && prop.getValue<uint32_t>("Has Decal 2 Texture")) {
-						textures["Decal2"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 2 Texture"));
-					}
+				if (hasFlag(prop, "Has Decal 1 Texture")) {
+					textures["Decal1"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 1 Texture"));
+				}
 
-					if (prop.data.count("Has Decal 3 Texture") && prop.getValue<uint32_t>("Has Decal 3 Texture")) {
-						textures["Decal3"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 3 Texture"));
-					}
+				if (hasFlag(prop, "Has Decal 2 Texture")) {
+					textures["Decal2"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 2 Texture"));
+				}
 
-					if (prop.data.count("Shader Textures")) {
-						Json::Value shader(Json::arrayValue);
+				if (hasFlag(prop, "Has Decal 3 Texture")) {
+					textures["Decal3"] = convertTexDesc(material, prop.getValue<NIFDictionary>("Decal 3 Texture"));
+				}
 
-						for (const auto &texVal : prop.getValue<NIFArray>("Shader Textures").data) {
-							shader.append(convertTexDesc(material, std::get<NIFDictionary>(texVal)));
-						}
+				if (auto shaderTextures = findValue<NIFArray>(prop, "Shader Textures")) {
+					Json::Value shader(Json::arrayValue);
 
-						textures["Shader"] = std::move(shader);
+					for (const auto &texVal : shaderTextures->data) {
+						shader.append(convertTexDesc(material, std::get<NIFDictionary>(texVal)));
 					}
 
-					extendedData["Textures"] = std::move(textures);
+					textures["Shader"] = std::move(shader);
+				}
+
+				extendedData["Textures"] = std::move(textures);
 
-				});
+			});
+
+		}
+	}
+
+	void FBXSceneWriter::processAlphaProperty(const NIFDictionary &prop, FbxNode *node, Pass pass) {
+		if (includesPass(pass, Pass::Geometry) && !m_reusingMaterial) {
+			auto material = static_cast<fbxsdk::FbxSurfacePhong *>(establishMaterial(node));
+
+			manipulateExtendedMaterialData(material, [&](Json::Value &extendedData) {
+				extendedData["AlphaFlags"] = prop.getValue<uint32_t>("Flags");
+				extendedData["AlphaThreshold"] = static_cast<int32_t>(prop.getValue<uint32_t>("Threshold"));
+			});
+		}
+	}
+
+	void FBXSceneWriter::applyVertexColorProperties(const NIFDictionary &dict, FbxNode *node) {
+		const auto &sym = symbols();
+
+		if (auto properties = findValue<NIFArray>(dict, sym.properties)) {
+			for (const auto &prop : properties->data) {
+				const auto &ptr = std::get<NIFReference>(prop).ptr;
+				if (!ptr)
+					continue;
+
+				const auto &propDict = std::get<NIFDictionary>(*ptr);
+				if (propDict.kindOf(sym.niVertexColorProperty)) {
+					processVertexColorProperty(propDict, node, Pass::Geometry);
+				}
+			}
+		}
+	}
+
+	void FBXSceneWriter::processVertexColorProperty(const NIFDictionary &prop, FbxNode *node, Pass pass) {
+		if (includesPass(pass, Pass::Geometry)) {
+			auto flags = prop.getValue<uint32_t>("Flags");
+			
+			m_vertexColorLightingMode = (flags >> 3) & 1;
+			m_vertexColorVertexMode = (flags >> 4) & 3;
+
+			if (auto vertexMode = findValue<NIFEnum>(prop, "Vertex Mode")) {
+				m_vertexColorVertexMode = vertexMode->rawValue;
+			}
+
+			if (auto lightingMode = findValue<NIFEnum>(prop, "Lighting Mode")) {
+				m_vertexColorLightingMode = lightingMode->rawValue;
+			}
+
+		}
+	}
+
+	NIF2FBXExtension2 *FBXSceneWriter::extension2() const {
+		if (m_extensionVersion < NIF2FBXExtension2::Version)
+			return nullptr;
+
+		return static_cast<NIF2FBXExtension2 *>(m_extension);
+	}
 
+	void FBXSceneWriter::requestTextureTranslations(const NIFDictionary &root) {
+		std::unordered_set<std::string> names;
+		collectTextureNames(root, names);
+
+		std::vector<std::string> originalNames;
+		std::string assetName, fileName;
+
+		for (const auto &name : names) {
+			if (!m_textureNameCache || !m_textureNameCache->find(name, assetName, fileName)) {
+				originalNames.push_back(name);
 			}
+		}
 
+		if (!originalNames.empty()) {
+			printf("Requesting translation of %zu texture names\n", originalNames.size());
+
+			m_pendingTextureTranslations = std::make_unique<TextureTranslationRequest>();
+			extension2()->translateTextureAssets(originalNames, m_assetSource, m_pendingTextureTranslations.get());
 		}
-		else if (prop.kindOf("NiAlphaProperty")) {
-			if (pass == Pass::Geometry) {
-				auto material = static_cast<fbxsdk::FbxSurfacePhong *>(establishMaterial(node));
+	}
+
+	void FBXSceneWriter::collectTextureTranslations() {
+		if (!m_pendingTextureTranslations)
+			return;
+
+		auto translations = m_pendingTextureTranslations->take();
+		m_pendingTextureTranslations.reset();
 
-				manipulateExtendedMaterialData(material, [&](Json::Value &extendedData) {
-					extendedData["AlphaFlags"] = prop.getValue<uint32_t>("Flags");
-					extendedData["AlphaThreshold"] = static_cast<int32_t>(prop.getValue<uint32_t>("Threshold"));
-				});
+		for (auto &translation : translations) {
+			if (m_textureNameCache) {
+				m_textureNameCache->insert(translation.originalName, translation.assetName, translation.fileName);
 			}
+
+			m_textureTranslations.emplace(std::move(translation.originalName), TextureTranslation{ std::move(translation.assetName), std::move(translation.fileName) });
 		}
-		else if (prop.kindOf("NiVertexColorProperty")) {
-			if (pass == Pass::Structural) {
-				auto flags = prop.getValue<uint32_t>("Flags");
-				
-				m_vertexColorLightingMode = (flags >> 3) & 1;
-				m_vertexColorVertexMode = (flags >> 4) & 3;
+	}
+
+	void FBXSceneWriter::collectTextureNames(const NIFDictionary &node, std::unordered_set<std::string> &names) {
+		const auto &sym = symbols();
+
+		if (auto properties = findValue<NIFArray>(node, sym.properties)) {
+			for (const auto &prop : properties->data) {
+				const auto &ptr = std::get<NIFReference>(prop).ptr;
+				if (!ptr)
+					continue;
+
+				const auto &propDict = std::get<NIFDictionary>(*ptr);
+				if (!propDict.kindOf(sym.niTexturingProperty))
+					continue;
 
-				if (prop.data.count("Vertex Mode") != 0) {
-					m_vertexColorVertexMode = prop.getValue<NIFEnum>("Vertex Mode").rawValue;
+				for (const auto &field : propDict.data) {
+					if (auto texDesc = std::get_if<NIFDictionary>(&field.second)) {
+						collectTextureName(*texDesc, names);
+					}
 				}
 
-				if (prop.data.count("Lighting Mode") != 0) {
-					m_vertexColorLightingMode = prop.getValue<NIFEnum>("Lighting Mode").rawValue;
+				if (auto shaderTextures = findValue<NIFArray>(propDict, "Shader Textures")) {
+					for (const auto &texVal : shaderTextures->data) {
+						collectTextureName(std::get<NIFDictionary>(texVal), names);
+					}
 				}
+			}
+		}
 
+		if (auto children = findValue<NIFArray>(node, sym.children)) {
+			for (const auto &child : children->data) {
+				const auto &ptr = std::get<NIFReference>(child).ptr;
+				if (ptr) {
+					collectTextureNames(std::get<NIFDictionary>(*ptr), names);
+				}
 			}
 		}
+	}
+
+	void FBXSceneWriter::collectTextureName(const NIFDictionary &texDesc, std::unordered_set<std::string> &names) {
+		auto sourceRef = findValue<NIFReference>(texDesc, "Source");
+		if (!sourceRef || !sourceRef->ptr)
+			return;
+
+		const auto &source = std::get<NIFDictionary>(*sourceRef->ptr);
+		if (hasFlag(source, "Use External")) {
+			names.emplace(getString(source.getValue<NIFDictionary>("File Name"), m_file.header()));
+		}
+	}
+
+	void FBXSceneWriter::translateTextureName(const std::string &sourceFile, std::string &assetName, std::string &fileName) {
+		collectTextureTranslations();
+
+		auto it = m_textureTranslations.find(sourceFile);
+		if (it != m_textureTranslations.end()) {
+			assetName = it->second.assetName;
+			fileName = it->second.fileName;
+			return;
+		}
+
+		if (m_textureNameCache && m_textureNameCache->find(sourceFile, assetName, fileName))
+			return;
+
+		auto extension = extension2();
+		if (extension && m_assetSource) {
+			extension->resolveTextureAsset(sourceFile, m_assetSource, assetName, fileName);
+		}
 		else {
-			fprintf(stderr, "Unsupported property: '%s' on %s\n", prop.typeChain.front().toString(), node->GetName());
+			m_extension->translateTextureAsset(sourceFile, assetName, fileName);
 		}
 
-		if (pass == Pass::Animation) {
-			for (auto controller = prop.getValue<NIFReference>("Controller"); controller.ptr; controller = std::get<NIFDictionary>(*controller.ptr).getValue<NIFReference>("Next Controller")) {
-				processController(std::get<NIFDictionary>(*controller.ptr), node);
-			}
+		if (m_textureNameCache) {
+			m_textureNameCache->insert(sourceFile, assetName, fileName);
 		}
 	}
 
+	/*
+	 * Older games store texture paths relative to the textures directory, so
+	 * that candidate is tried first; otherwise a path could resolve to an
+	 * unrelated entry through ArchiveSet's data directory stripping.
+	 */
+	bool FBXSceneWriter::resolveArchivedTexture(const std::string &sourceFile, std::string &archiveName, std::string &entryName) const {
+		static const char texturesDirectory[] = "textures";
+		const size_t texturesDirectoryLength = sizeof(texturesDirectory) - 1;
+
+		bool prefixed = sourceFile.size() > texturesDirectoryLength &&
+			(sourceFile[texturesDirectoryLength] == '\\' || sourceFile[texturesDirectoryLength] == '/') &&
+			std::equal(texturesDirectory, texturesDirectory + texturesDirectoryLength, sourceFile.begin(), [](char a, char b) {
+				return a == std::tolower(static_cast<unsigned char>(b));
+			});
+
+		if (!prefixed && m_assetSource->resolveAsset("textures\\" + sourceFile, archiveName, entryName))
+			return true;
+
+		return m_assetSource->resolveAsset(sourceFile, archiveName, entryName);
+	}
+
+	auto FBXSceneWriter::convertTextureSource(const std::string &sourceFile) -> ConvertedTexture {
+		ConvertedTexture converted;
+
+		std::string archiveName, entryName;
+
+		if (m_extension) {
+			converted.origin = TextureOrigin::Extension;
+
+			translateTextureName(sourceFile, converted.assetName, converted.fileName);
+		} else if (m_assetSource && resolveArchivedTexture(sourceFile, archiveName, entryName)) {
+			converted.origin = TextureOrigin::Archive;
+			converted.assetName = archiveName;
+			converted.fileName = entryName;
+		} else {
+			converted.origin = TextureOrigin::File;
+			converted.fileName = sourceFile;
+		}
+
+		return converted;
+	}
+
 	Json::Value FBXSceneWriter::convertTexDesc(FbxSurfaceMaterial *material, const NIFDictionary &texDesc) {
 		Json::Value result(Json::objectValue);
 
@@ -1473,66 +1942,92 @@ namespace fbxnif {
 			phong->Diffuse.ConnectSrcObject(sourceTexture);
 		}
 
-		auto texture = FbxFileTexture::Create(m_scene, "");
-		sourceTexture->ConnectSrcObject(texture);
-
 		const auto &sourceRef = texDesc.getValue<NIFReference>("Source");
 		if (!sourceRef.ptr)
 			throw std::logic_error("no source for texture");
 
-		const auto &source = std::get<NIFDictionary>(*sourceRef.ptr);
+		/*
+		 * Each texture file name is translated, or looked up in the archives,
+		 * only once per scene. Every slot still gets its own texture object,
+		 * so that the layers line up with the Textures extended data.
+		 */
+		const ConvertedTexture *converted;
+
+		auto sourceIt = m_textureSources.find(sourceRef.ptr);
+		if (sourceIt != m_textureSources.end()) {
+			converted = sourceIt->second;
+		}
+		else {
+			const auto &source = std::get<NIFDictionary>(*sourceRef.ptr);
+
+			if (!source.getValue<uint32_t>("Use External")) {
+				throw std::logic_error("internal textures are not supported");
+			}
 
-		if (source.getValue<uint32_t>("Use External")) {
-			const auto& sourceFile = getString(source.getValue<NIFDictionary>("File Name"), m_file.header());
+			auto sourceFile = getString(source.getValue<NIFDictionary>("File Name"), m_file.header());
 
-			if (m_extension) {
-				std::string assetName, fileName;
-				m_extension->translateTextureAsset(sourceFile, assetName, fileName);
-				result["AssetName"] = assetName;
-				result["FileName"] = fileName;
-				texture->SetFileName(fileName.c_str());
-			} else {
-				result["FileName"] = sourceFile;
-				texture->SetRelativeFileName(sourceFile.c_str());
+			auto fileIt = m_textures.find(sourceFile);
+			if (fileIt == m_textures.end()) {
+				fileIt = m_textures.emplace(sourceFile, convertTextureSource(sourceFile)).first;
 			}
 
+			converted = &fileIt->second;
+			m_textureSources.emplace(sourceRef.ptr, converted);
 		}
-		else {
-			throw std::logic_error("internal textures are not supported");
+
+		auto texture = FbxFileTexture::Create(m_scene, "");
+		sourceTexture->ConnectSrcObject(texture);
+
+		switch (converted->origin) {
+		case TextureOrigin::Extension:
+			result["AssetName"] = converted->assetName;
+			texture->SetFileName(converted->fileName.c_str());
+			break;
+
+		case TextureOrigin::Archive:
+			result["Archive"] = converted->assetName;
+			texture->SetRelativeFileName(converted->fileName.c_str());
+			break;
+
+		case TextureOrigin::File:
+			texture->SetRelativeFileName(converted->fileName.c_str());
+			break;
 		}
 
-		if (texDesc.data.count("Clamp Mode") != 0) {
-			result["ClampMode"] = texDesc.getValue<NIFEnum>("Clamp Mode").rawValue;
+		result["FileName"] = converted->fileName;
+
+		if (auto clampMode = findValue<NIFEnum>(texDesc, "Clamp Mode")) {
+			result["ClampMode"] = clampMode->rawValue;
 		}
 
-		if (texDesc.data.count("Filter Mode") != 0) {
-			result["FilterMode"] = texDesc.getValue<NIFEnum>("Filter Mode").rawValue;
+		if (auto filterMode = findValue<NIFEnum>(texDesc, "Filter Mode")) {
+			result["FilterMode"] = filterMode->rawValue;
 		}
 
-		if (texDesc.data.count("Flags") != 0) {
-			auto flags = texDesc.getValue<uint32_t>("Flags");
+		if (auto flagsValue = findValue<uint32_t>(texDesc, "Flags")) {
+			auto flags = *flagsValue;
 
 			result["ClampMode"] = (flags >> 12) & 15;
 			result["FilterMode"] = (flags >> 8) & 15;
 		}
 
-		if (texDesc.data.count("Max Anisotropy") != 0) {
-			result["MaxAnisotropy"] = texDesc.getValue<uint32_t>("Max Anisotropy");
+		if (auto maxAnisotropy = findValue<uint32_t>(texDesc, "Max Anisotropy")) {
+			result["MaxAnisotropy"] = *maxAnisotropy;
 		}
 
-		if (texDesc.data.count("UV Set") != 0) {
-			result["UVSet"] = texDesc.getValue<uint32_t>("UV Set");
+		if (auto uvSet = findValue<uint32_t>(texDesc, "UV Set")) {
+			result["UVSet"] = *uvSet;
 		}
 
-		if (texDesc.data.count("PS2 L") != 0) {
-			result["MipScale"] = texDesc.getValue<uint32_t>("PS2 L");
+		if (auto ps2L = findValue<uint32_t>(texDesc, "PS2 L")) {
+			result["MipScale"] = *ps2L;
 		}
 
-		if (texDesc.data.count("PS2 K") != 0) {
-			result["MipBias"] = static_cast<int32_t>(texDesc.getValue<uint32_t>("PS2 K"));
+		if (auto ps2K = findValue<uint32_t>(texDesc, "PS2 K")) {
+			result["MipBias"] = static_cast<int32_t>(*ps2K);
 		}
 
-		if (texDesc.data.count("Has Texture Transform") && texDesc.getValue<uint32_t>("Has Texture Transform")) {
+		if (hasFlag(texDesc, "Has Texture Transform")) {
 			result["Translation"] = toJsonValue(getTexCoord(texDesc.getValue<NIFDictionary>("Translation")));
 			result["Scale"] = toJsonValue(getTexCoord(texDesc.getValue<NIFDictionary>("Scale")));
 			result["Rotation"] = static_cast<double>(texDesc.getValue<float>("Rotation"));
@@ -9,10 +9,22 @@
 #include <fbxsdk/core/math/fbxaffinematrix.h>
 #include <fbxsdk/scene/geometry/fbxmesh.h>
 
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <map>
+#include <tuple>
+#include <functional>
+
+#include "TypeDispatchTable.h"
+#include "BSVertexDecoder.h"
+#include "SkeletonProcessor.h"
 
 #include <json-forwards.h>
 
+#include <NIF2FBXExtension.h>
+
 namespace nifparse {
 	class NIFFile;
 }
@@ -22,12 +34,13 @@ namespace fbxsdk {
 	class FbxNode;
 	class FbxScene;
 	class FbxAnimCurve;
+	class FbxFileTexture;
 }
 
-class NIF2FBXExtension;
+class NIF2FBXAssetSource;
 
 namespace fbxnif {
-	class SkeletonProcessor;
+	class TextureNameCache;
 
 	enum : uint32_t {
 		// NiAVObject flags
@@ -36,6 +49,25 @@ namespace fbxnif {
 
 	class FBXSceneWriter {
 	public:
+		enum class Pass : unsigned int {
+			None = 0,
+			Structural = 1 << 0,
+			Geometry = 1 << 1,
+			Animation = 1 << 2,
+			All = Structural | Geometry | Animation
+		};
+
+		static inline bool includesPass(Pass pass, Pass stage) {
+			return (static_cast<unsigned int>(pass) & static_cast<unsigned int>(stage)) != 0;
+		}
+
+		static inline Pass withoutPass(Pass pass, Pass stage) {
+			return static_cast<Pass>(static_cast<unsigned int>(pass) & ~static_cast<unsigned int>(stage));
+		}
+
+		using BlockHandler = std::function<void(const NIFDictionary &dict, FbxNode *node, Pass pass)>;
+		using ControllerHandler = std::function<void(const NIFDictionary &controller, FbxNode *node)>;
+
 		FBXSceneWriter(const NIFFile &file, const SkeletonProcessor &skeleton);
 		~FBXSceneWriter();
 
@@ -50,13 +82,33 @@ namespace fbxnif {
 		inline NIF2FBXExtension* extension() const { return m_extension; }
 		inline void setExtension(NIF2FBXExtension* extension) { m_extension = extension; }
 
-	private:
-		enum class Pass {
-			Structural,
-			Geometry,
-			Animation
-		};
+		// Interface version the extension was declared with (ExtensionVersion import option)
+		inline int extensionVersion() const { return m_extensionVersion; }
+		inline void setExtensionVersion(int extensionVersion) { m_extensionVersion = extensionVersion; }
+
+		inline const NIF2FBXAssetSource *assetSource() const { return m_assetSource; }
+		inline void setAssetSource(const NIF2FBXAssetSource *assetSource) { m_assetSource = assetSource; }
+
+		inline const std::shared_ptr<TextureNameCache> &textureNameCache() const { return m_textureNameCache; }
+		inline void setTextureNameCache(const std::shared_ptr<TextureNameCache> &textureNameCache) { m_textureNameCache = textureNameCache; }
+
+		/*
+		 * Convert the scene in one traversal instead of separate structural,
+		 * geometry and animation passes. References to nodes that are not
+		 * created yet are resolved after the traversal.
+		 */
+		inline bool singlePass() const { return m_singlePass; }
+		inline void setSinglePass(bool singlePass) { m_singlePass = singlePass; }
 
+		/*
+		 * Handlers for scene node, property and controller block types. These
+		 * take precedence over the built-in handlers for the same types.
+		 */
+		void registerSceneNodeHandler(const Symbol &type, BlockHandler handler, bool includeSubclasses = true);
+		void registerPropertyHandler(const Symbol &type, BlockHandler handler, bool includeSubclasses = true);
+		void registerControllerHandler(const Symbol &type, ControllerHandler handler, bool includeSubclasses = true);
+
+	private:
 		enum class CurveGenerationMode {
 			Rotation,
 			Translation,
@@ -67,6 +119,28 @@ namespace fbxnif {
 			RotationQuaternion
 		};
 
+		// Property blocks of a node, vertex color mode, vertex lighting mode
+		using MaterialKey = std::tuple<std::vector<const NIFVariant *>, unsigned int, unsigned int>;
+
+		enum class TextureOrigin {
+			Extension,
+			Archive,
+			File
+		};
+
+		struct TextureTranslation {
+			std::string assetName;
+			std::string fileName;
+		};
+
+		class TextureTranslationRequest;
+
+		struct ConvertedTexture {
+			TextureOrigin origin;
+			std::string assetName; // asset name for Extension, archive name for Archive
+			std::string fileName;
+		};
+
 		struct AnimationTake {
 			FbxAnimStack *stack;
 			FbxAnimLayer *defaultLayer;
@@ -81,13 +155,24 @@ namespace fbxnif {
 		template<typename ElementType>
 		void importVectorElement(const NIFDictionary &data, FbxMesh *mesh, const Symbol &name, ElementType *(FbxGeometryBase::*createElement)());
 		
+		void setVectorElementData(FbxLayerElementArrayTemplate<FbxVector4> &vectorData, const std::vector<float> &components);
+
+		FbxMesh *importGeometryData(const NIFDictionary &data, const std::string &name);
 		void importMeshTriangles(FbxMesh *mesh, const NIFDictionary &container);
+		void appendTriangles(FbxMesh *mesh, const std::vector<uint32_t> &indices);
+		void importSkin(const SkeletonProcessor::SkinWeights &weights, FbxMesh *mesh);
 		void importMeshTriangleStrips(FbxMesh *mesh, const NIFDictionary &container);
 
 		FbxNode *findSkeletonRoot(FbxNode *parent);
 		void registerImportedBones(FbxNode *bone);
+		void indexNodeName(FbxNode *node);
+		FbxNode *findNodeByName(std::string_view name) const;
 
 		void processController(const NIFDictionary &controller, FbxNode *node);
+		void processKeyframeController(const NIFDictionary &controller, FbxNode *node);
+		void processControllerManager(const NIFDictionary &controller, FbxNode *node);
+		void processControllerSequences(const NIFDictionary &controller);
+		void processGeomMorpherController(const NIFDictionary &controller, FbxNode *node);
 
 		template<typename PropertyType>
 		void generateCurves(const NIFDictionary &keyGroup, FbxPropertyT<PropertyType> &prop, FbxAnimLayer *layer, CurveGenerationMode mode, FbxAnimCurveNode *&node);
@@ -99,12 +184,20 @@ namespace fbxnif {
 		
 		void ensureSkeletonImported(FbxNode *node);
 		
+		void processProperties(const NIFDictionary &dict, FbxNode *node, Pass pass);
 		void processProperty(const NIFDictionary &prop, FbxNode *node, Pass pass);
+		void processMaterialProperty(const NIFDictionary &prop, FbxNode *node, Pass pass);
+		void processTexturingProperty(const NIFDictionary &prop, FbxNode *node, Pass pass);
+		void processAlphaProperty(const NIFDictionary &prop, FbxNode *node, Pass pass);
+		void processVertexColorProperty(const NIFDictionary &prop, FbxNode *node, Pass pass);
+		void applyVertexColorProperties(const NIFDictionary &dict, FbxNode *node);
 
 		template<typename Functor>
 		void manipulateExtendedMaterialData(FbxSurfaceMaterial *material, Functor &&functor);
+		void writeExtendedMaterialData();
 
 		FbxSurfaceMaterial *establishMaterial(FbxNode *node);
+		void attachMaterial(FbxNode *node, FbxSurfaceMaterial *material);
 
 		AnimationTake &getCurrentTake();
 		FbxAnimLayer *getDefaultTakelayer(AnimationTake &take);
@@ -113,13 +206,31 @@ namespace fbxnif {
 		void applyInterpolatorTransform(const NIFDictionary &interpolator, FbxNode *node);
 		void processBSplineAnimation(const NIFDictionary &interpolator, FbxNode *node);
 		
+		NIF2FBXExtension2 *extension2() const;
+
+		void requestTextureTranslations(const NIFDictionary &root);
+		void collectTextureTranslations();
+		void collectTextureNames(const NIFDictionary &node, std::unordered_set<std::string> &names);
+		void collectTextureName(const NIFDictionary &texDesc, std::unordered_set<std::string> &names);
+		void translateTextureName(const std::string &sourceFile, std::string &assetName, std::string &fileName);
+		bool resolveArchivedTexture(const std::string &sourceFile, std::string &archiveName, std::string &entryName) const;
+		ConvertedTexture convertTextureSource(const std::string &sourceFile);
 		Json::Value convertTexDesc(FbxSurfaceMaterial *material, const NIFDictionary &texDesc);
 
 		const NIFFile &m_file;
 		const SkeletonProcessor &m_skeleton;
 		FbxScene *m_scene;
-		std::unordered_map<std::shared_ptr<NIFVariant>, FbxNode *> m_nodeMap;
+		std::vector<FbxNode *> m_nodeMap; // by SkeletonProcessor node index
 		std::unordered_map<std::string, FbxNode *> m_importedBoneMap;
+		std::unordered_map<std::string_view, FbxNode *> m_nodesByName;
+		std::unordered_map<std::shared_ptr<NIFVariant>, FbxMesh *> m_sharedMeshes;
+		std::map<MaterialKey, FbxSurfaceMaterial *> m_materialCache;
+		std::unordered_map<FbxSurfaceMaterial *, std::unique_ptr<Json::Value>> m_extendedMaterialData;
+		std::unordered_map<std::string, ConvertedTexture> m_textures;
+		std::unordered_map<std::shared_ptr<NIFVariant>, const ConvertedTexture *> m_textureSources;
+		std::shared_ptr<TextureNameCache> m_textureNameCache;
+		std::unique_ptr<TextureTranslationRequest> m_pendingTextureTranslations;
+		std::unordered_map<std::string, TextureTranslation> m_textureTranslations;
 		unsigned int m_meshesGenerated;
 		unsigned int m_skeletonNodesGenerated;
 		FbxString m_skeletonFile;
@@ -128,6 +239,17 @@ namespace fbxnif {
 		unsigned int m_vertexColorVertexMode;
 		unsigned int m_vertexColorLightingMode;
 		NIF2FBXExtension* m_extension;
+		int m_extensionVersion;
+		const NIF2FBXAssetSource *m_assetSource;
+		std::vector<float> m_componentBuffer;
+		std::vector<uint32_t> m_indexBuffer;
+		BSVertexDecoder m_bsVertexDecoder;
+		TypeDispatchTable<BlockHandler> m_sceneNodeHandlers;
+		TypeDispatchTable<BlockHandler> m_propertyHandlers;
+		TypeDispatchTable<ControllerHandler> m_controllerHandlers;
+		bool m_singlePass;
+		bool m_reusingMaterial;
+		std::vector<std::function<void()>> m_deferred;
 	};
 }
 
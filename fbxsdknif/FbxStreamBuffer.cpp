@@ -0,0 +1,110 @@
+#include "FbxStreamBuffer.h"
+
+#include <fbxsdk/core/fbxstream.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace fbxnif {
+	FbxStreamBuffer::FbxStreamBuffer(FbxStream *stream) : m_stream(stream) {
+		setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+	}
+
+	FbxStreamBuffer::~FbxStreamBuffer() = default;
+
+	auto FbxStreamBuffer::underflow() -> int_type {
+		if (gptr() < egptr())
+			return traits_type::to_int_type(*gptr());
+
+		auto bytesRead = m_stream->Read(m_buffer.data(), m_buffer.size());
+		if (bytesRead <= 0) {
+			setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+			return traits_type::eof();
+		}
+
+		setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + bytesRead);
+
+		return traits_type::to_int_type(*gptr());
+	}
+
+	std::streamsize FbxStreamBuffer::xsgetn(char_type *s, std::streamsize count) {
+		std::streamsize total = 0;
+
+		auto buffered = std::min<std::streamsize>(egptr() - gptr(), count);
+		if (buffered > 0) {
+			memcpy(s, gptr(), static_cast<size_t>(buffered));
+			gbump(static_cast<int>(buffered));
+			total += buffered;
+		}
+
+		// Large reads bypass the staging buffer and go directly into the destination
+		while (total < count) {
+			auto remaining = count - total;
+
+			if (remaining < static_cast<std::streamsize>(m_buffer.size())) {
+				if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+					break;
+
+				auto chunk = std::min<std::streamsize>(egptr() - gptr(), remaining);
+				memcpy(s + total, gptr(), static_cast<size_t>(chunk));
+				gbump(static_cast<int>(chunk));
+				total += chunk;
+			}
+			else {
+				auto bytesRead = m_stream->Read(s + total, static_cast<size_t>(remaining));
+				if (bytesRead <= 0)
+					break;
+
+				total += static_cast<std::streamsize>(bytesRead);
+			}
+		}
+
+		return total;
+	}
+
+	auto FbxStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) -> pos_type {
+		if ((which & std::ios_base::in) == 0)
+			return pos_type(off_type(-1));
+
+		if (dir == std::ios_base::cur && off == 0) {
+			// Position query, keep the buffered data
+			return pos_type(off_type(m_stream->GetPosition() - (egptr() - gptr())));
+		}
+
+		FbxInt64 offset = off;
+		FbxFile::ESeekPos origin;
+
+		switch (dir) {
+		case std::ios_base::beg:
+			origin = FbxFile::eBegin;
+			break;
+
+		case std::ios_base::cur:
+			// The underlying stream is ahead of the logical position by the unread part of the buffer
+			offset -= egptr() - gptr();
+			origin = FbxFile::eCurrent;
+			break;
+
+		case std::ios_base::end:
+			origin = FbxFile::eEnd;
+			break;
+
+		default:
+			return pos_type(off_type(-1));
+		}
+
+		m_stream->Seek(offset, origin);
+		setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+
+		if (m_stream->GetError() != 0) {
+			m_stream->ClearError();
+			return pos_type(off_type(-1));
+		}
+
+		return pos_type(off_type(m_stream->GetPosition()));
+	}
+
+	auto FbxStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which) -> pos_type {
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef FBX_STREAM_BUFFER_H
+#define FBX_STREAM_BUFFER_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <streambuf>
+#include <array>
+
+namespace fbxsdk {
+	class FbxStream;
+}
+
+namespace fbxnif {
+	/*
+	 * Read-only std::streambuf pulling data from a caller-supplied FbxStream.
+	 * FbxStream only offers a copying Read, so data is staged through a
+	 * fixed-size buffer; in-memory sources should use MemoryStreamBuffer.
+	 */
+	class FbxStreamBuffer final : public std::streambuf {
+	public:
+		explicit FbxStreamBuffer(FbxStream *stream);
+		virtual ~FbxStreamBuffer();
+
+		FbxStreamBuffer(const FbxStreamBuffer &other) = delete;
+		FbxStreamBuffer &operator =(const FbxStreamBuffer &other) = delete;
+
+	protected:
+		virtual int_type underflow() override;
+		virtual std::streamsize xsgetn(char_type *s, std::streamsize count) override;
+		virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override;
+		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override;
+
+	private:
+		FbxStream *m_stream;
+		std::array<char, 65536> m_buffer;
+	};
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "LZ4Decoder.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+namespace fbxnif {
+	enum : uint32_t {
+		LZ4FrameMagic = 0x184D2204,
+		LZ4FrameUncompressedBlock = 0x80000000,
+		LZ4MinMatch = 4
+	};
+
+	enum : uint8_t {
+		LZ4FrameFlagVersionMask = 0xC0,
+		LZ4FrameFlagVersion = 0x40,
+		LZ4FrameFlagBlockChecksum = 0x10,
+		LZ4FrameFlagContentSize = 0x08,
+		LZ4FrameFlagContentChecksum = 0x04,
+		LZ4FrameFlagDictionaryID = 0x01
+	};
+
+	static inline uint32_t readU32(const unsigned char *data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	/*
+	 * Decodes one block into [outputStart + outputOffset, outputStart + outputEnd).
+	 * Matches may reach back before outputOffset, which is how linked frame
+	 * blocks reference the data decoded from previous blocks.
+	 */
+	static size_t decodeBlock(const unsigned char *source, size_t sourceSize, unsigned char *outputStart, size_t outputOffset, size_t outputEnd) {
+		auto input = source;
+		auto inputEnd = source + sourceSize;
+		auto output = outputStart + outputOffset;
+		auto outputLimit = outputStart + outputEnd;
+
+		while (input < inputEnd) {
+			auto token = *input++;
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15) {
+				uint8_t extra;
+				do {
+					if (input >= inputEnd)
+						throw std::runtime_error("LZ4: truncated literal length");
+
+					extra = *input++;
+					literalLength += extra;
+				} while (extra == 255);
+			}
+
+			if (literalLength > static_cast<size_t>(inputEnd - input) || literalLength > static_cast<size_t>(outputLimit - output))
+				throw std::runtime_error("LZ4: literal run out of bounds");
+
+			memcpy(output, input, literalLength);
+			input += literalLength;
+			output += literalLength;
+
+			// The last sequence of a block consists of literals only
+			if (input == inputEnd)
+				break;
+
+			if (inputEnd - input < 2)
+				throw std::runtime_error("LZ4: truncated match offset");
+
+			size_t offset = static_cast<size_t>(input[0]) | (static_cast<size_t>(input[1]) << 8);
+			input += 2;
+
+			if (offset == 0 || offset > static_cast<size_t>(output - outputStart))
+				throw std::runtime_error("LZ4: match offset out of bounds");
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15) {
+				uint8_t extra;
+				do {
+					if (input >= inputEnd)
+						throw std::runtime_error("LZ4: truncated match length");
+
+					extra = *input++;
+					matchLength += extra;
+				} while (extra == 255);
+			}
+			matchLength += LZ4MinMatch;
+
+			if (matchLength > static_cast<size_t>(outputLimit - output))
+				throw std::runtime_error("LZ4: match out of bounds");
+
+			auto match = output - offset;
+			if (offset >= matchLength) {
+				memcpy(output, match, matchLength);
+				output += matchLength;
+			}
+			else {
+				// Overlapping match: replicates the last 'offset' bytes
+				for (size_t index = 0; index < matchLength; index++) {
+					*output++ = *match++;
+				}
+			}
+		}
+
+		return static_cast<size_t>(output - outputStart) - outputOffset;
+	}
+
+	void decompressLZ4Block(const unsigned char *source, size_t sourceSize, unsigned char *destination, size_t destinationSize) {
+		auto decoded = decodeBlock(source, sourceSize, destination, 0, destinationSize);
+		if (decoded != destinationSize)
+			throw std::runtime_error("LZ4: decompressed size mismatch");
+	}
+
+	void decompressLZ4Frame(const unsigned char *source, size_t sourceSize, unsigned char *destination, size_t destinationSize) {
+		auto input = source;
+		auto inputEnd = source + sourceSize;
+
+		if (sourceSize < 7 || readU32(input) != LZ4FrameMagic)
+			throw std::runtime_error("LZ4: bad frame magic");
+
+		input += 4;
+
+		auto flags = *input++;
+		input++; // block descriptor: maximum block size is irrelevant, the output size is known
+
+		if ((flags & LZ4FrameFlagVersionMask) != LZ4FrameFlagVersion)
+			throw std::runtime_error("LZ4: unsupported frame version");
+
+		if (flags & LZ4FrameFlagContentSize)
+			input += 8;
+
+		if (flags & LZ4FrameFlagDictionaryID)
+			throw std::runtime_error("LZ4: frames with external dictionaries are not supported");
+
+		input++; // header checksum
+
+		size_t outputOffset = 0;
+
+		for (;;) {
+			if (inputEnd - input < 4)
+				throw std::runtime_error("LZ4: truncated frame");
+
+			auto blockSize = readU32(input);
+			input += 4;
+
+			if (blockSize == 0)
+				break;
+
+			auto uncompressed = (blockSize & LZ4FrameUncompressedBlock) != 0;
+			blockSize &= ~LZ4FrameUncompressedBlock;
+
+			if (blockSize > static_cast<size_t>(inputEnd - input))
+				throw std::runtime_error("LZ4: truncated block");
+
+			if (uncompressed) {
+				if (blockSize > destinationSize - outputOffset)
+					throw std::runtime_error("LZ4: block out of bounds");
+
+				memcpy(destination + outputOffset, input, blockSize);
+				outputOffset += blockSize;
+			}
+			else {
+				outputOffset += decodeBlock(input, blockSize, destination, outputOffset, destinationSize);
+			}
+
+			input += blockSize;
+
+			if (flags & LZ4FrameFlagBlockChecksum)
+				input += 4;
+		}
+
+		if (outputOffset != destinationSize)
+			throw std::runtime_error("LZ4: decompressed size mismatch");
+	}
+}
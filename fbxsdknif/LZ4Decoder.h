@@ -0,0 +1,18 @@
+#ifndef LZ4_DECODER_H
+#define LZ4_DECODER_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <cstddef>
+
+namespace fbxnif {
+	/*
+	 * Minimal LZ4 decompressors for archive entries. Both throw
+	 * std::runtime_error on malformed input, and require the output size
+	 * to be known in advance, as it always is in Bethesda archives.
+	 */
+	void decompressLZ4Block(const unsigned char *source, size_t sourceSize, unsigned char *destination, size_t destinationSize);
+	void decompressLZ4Frame(const unsigned char *source, size_t sourceSize, unsigned char *destination, size_t destinationSize);
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "MemoryMappedFile.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace fbxnif {
+#ifdef _WIN32
+	MemoryMappedFile::MemoryMappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_data(nullptr), m_size(0) {
+
+	}
+#else
+	MemoryMappedFile::MemoryMappedFile() : m_fd(-1), m_data(nullptr), m_size(0) {
+
+	}
+#endif
+
+	MemoryMappedFile::~MemoryMappedFile() {
+		close();
+	}
+
+	/*
+	 * Once mapped, the whole file is prefetched in the background so that
+	 * I/O overlaps parsing.
+	 */
+#ifdef _WIN32
+	void MemoryMappedFile::open(const char *filename) {
+		close();
+
+		m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("CreateFile failed: " + std::to_string(GetLastError()));
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) {
+			auto error = GetLastError();
+			close();
+			throw std::runtime_error("GetFileSizeEx failed: " + std::to_string(error));
+		}
+
+		if (size.QuadPart == 0) {
+			close();
+			throw std::runtime_error("empty files cannot be mapped");
+		}
+
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping) {
+			auto error = GetLastError();
+			close();
+			throw std::runtime_error("CreateFileMapping failed: " + std::to_string(error));
+		}
+
+		auto view = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view) {
+			auto error = GetLastError();
+			close();
+			throw std::runtime_error("MapViewOfFile failed: " + std::to_string(error));
+		}
+
+		m_data = static_cast<const unsigned char *>(view);
+		m_size = static_cast<size_t>(size.QuadPart);
+
+#if _WIN32_WINNT >= 0x0602
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = view;
+		range.NumberOfBytes = m_size;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+	}
+
+	void MemoryMappedFile::close() {
+		if (m_data) {
+			UnmapViewOfFile(m_data);
+			m_data = nullptr;
+		}
+
+		if (m_mapping) {
+			CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+
+		if (m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+
+		m_size = 0;
+	}
+#else
+	void MemoryMappedFile::open(const char *filename) {
+		close();
+
+		m_fd = ::open(filename, O_RDONLY);
+		if (m_fd < 0) {
+			throw std::runtime_error(std::string("open failed: ") + strerror(errno));
+		}
+
+		struct stat info;
+		if (fstat(m_fd, &info) < 0) {
+			auto error = errno;
+			close();
+			throw std::runtime_error(std::string("fstat failed: ") + strerror(error));
+		}
+
+		if (info.st_size == 0) {
+			close();
+			throw std::runtime_error("empty files cannot be mapped");
+		}
+
+		auto view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+		if (view == MAP_FAILED) {
+			auto error = errno;
+			close();
+			throw std::runtime_error(std::string("mmap failed: ") + strerror(error));
+		}
+
+		madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+		madvise(view, static_cast<size_t>(info.st_size), MADV_WILLNEED);
+
+		m_data = static_cast<const unsigned char *>(view);
+		m_size = static_cast<size_t>(info.st_size);
+	}
+
+	void MemoryMappedFile::close() {
+		if (m_data) {
+			munmap(const_cast<unsigned char *>(m_data), m_size);
+			m_data = nullptr;
+		}
+
+		if (m_fd >= 0) {
+			::close(m_fd);
+			m_fd = -1;
+		}
+
+		m_size = 0;
+	}
+#endif
+}
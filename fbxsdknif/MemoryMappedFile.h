@@ -0,0 +1,41 @@
+#ifndef MEMORY_MAPPED_FILE_H
+#define MEMORY_MAPPED_FILE_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <cstddef>
+
+namespace fbxnif {
+	/*
+	 * Read-only mapping of a whole file. Throws std::runtime_error if
+	 * the file cannot be opened or mapped (including empty files, which
+	 * cannot be mapped on either platform).
+	 */
+	class MemoryMappedFile {
+	public:
+		MemoryMappedFile();
+		~MemoryMappedFile();
+
+		MemoryMappedFile(const MemoryMappedFile &other) = delete;
+		MemoryMappedFile &operator =(const MemoryMappedFile &other) = delete;
+
+		void open(const char *filename);
+		void close();
+
+		inline bool isOpen() const { return m_data != nullptr; }
+		inline const unsigned char *data() const { return m_data; }
+		inline size_t size() const { return m_size; }
+
+	private:
+#ifdef _WIN32
+		void *m_file;
+		void *m_mapping;
+#else
+		int m_fd;
+#endif
+		const unsigned char *m_data;
+		size_t m_size;
+	};
+}
+
+#endif
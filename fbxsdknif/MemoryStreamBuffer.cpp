@@ -0,0 +1,55 @@
+#include "MemoryStreamBuffer.h"
+
+namespace fbxnif {
+	MemoryStreamBuffer::MemoryStreamBuffer(const void *data, size_t size) {
+		// The get area is never written to: putback only moves the pointer back over identical characters.
+		auto begin = const_cast<char *>(static_cast<const char *>(data));
+		setg(begin, begin, begin + size);
+	}
+
+	MemoryStreamBuffer::~MemoryStreamBuffer() = default;
+
+	auto MemoryStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) -> pos_type {
+		if ((which & std::ios_base::in) == 0)
+			return pos_type(off_type(-1));
+
+		off_type base;
+
+		switch (dir) {
+		case std::ios_base::beg:
+			base = 0;
+			break;
+
+		case std::ios_base::cur:
+			base = gptr() - eback();
+			break;
+
+		case std::ios_base::end:
+			base = egptr() - eback();
+			break;
+
+		default:
+			return pos_type(off_type(-1));
+		}
+
+		auto position = base + off;
+		if (position < 0 || position > egptr() - eback())
+			return pos_type(off_type(-1));
+
+		setg(eback(), eback() + position, egptr());
+
+		return pos_type(position);
+	}
+
+	auto MemoryStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which) -> pos_type {
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+
+	std::streamsize MemoryStreamBuffer::showmanyc() {
+		auto available = egptr() - gptr();
+		if (available == 0)
+			return -1;
+
+		return available;
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef MEMORY_STREAM_BUFFER_H
+#define MEMORY_STREAM_BUFFER_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <streambuf>
+
+namespace fbxnif {
+	/*
+	 * Read-only std::streambuf over an externally owned span of memory.
+	 * The span is used directly as the get area, so reads through the
+	 * stream copy straight from the source memory into the caller's
+	 * destination, with no intermediate buffering.
+	 */
+	class MemoryStreamBuffer final : public std::streambuf {
+	public:
+		MemoryStreamBuffer(const void *data, size_t size);
+		virtual ~MemoryStreamBuffer();
+
+		MemoryStreamBuffer(const MemoryStreamBuffer &other) = delete;
+		MemoryStreamBuffer &operator =(const MemoryStreamBuffer &other) = delete;
+
+	protected:
+		virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override;
+		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override;
+		virtual std::streamsize showmanyc() override;
+	};
+}
+
+#endif
@@ -0,0 +1,338 @@
+#include "NIFProbe.h"
+
+#include <nifparse/Symbol.h>
+
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+namespace fbxnif {
+	namespace {
+		enum : uint32_t {
+			Version_3_1_0_0 = 0x03010000,
+			Version_3_1_0_1 = 0x03010001,
+			Version_5_0_0_1 = 0x05000001,
+			Version_10_0_1_2 = 0x0A000102,
+			Version_10_0_1_8 = 0x0A000108,
+			Version_10_1_0_0 = 0x0A010000,
+			Version_20_0_0_3 = 0x14000003,
+			Version_20_0_0_4 = 0x14000004,
+			Version_20_0_0_5 = 0x14000005,
+			Version_20_2_0_5 = 0x14020005,
+			Version_20_2_0_7 = 0x14020007,
+			Version_20_3_1_2 = 0x14030102,
+			Version_30_0_0_0 = 0x1E000000
+		};
+
+		class HeaderReader {
+		public:
+			explicit HeaderReader(std::istream &stream) : m_stream(stream), m_littleEndian(true) {
+
+			}
+
+			inline void setLittleEndian(bool littleEndian) { m_littleEndian = littleEndian; }
+
+			void read(void *data, size_t size) {
+				m_stream.read(static_cast<char *>(data), size);
+				if (static_cast<size_t>(m_stream.gcount()) != size)
+					throw std::runtime_error("NIF header is truncated");
+			}
+
+			void skip(uint64_t bytes) {
+				m_stream.seekg(static_cast<std::streamoff>(bytes), std::ios_base::cur);
+				if (!m_stream)
+					throw std::runtime_error("NIF header is truncated");
+			}
+
+			uint8_t readUInt8() {
+				uint8_t value;
+				read(&value, sizeof(value));
+				return value;
+			}
+
+			uint16_t readUInt16() {
+				unsigned char bytes[2];
+				read(bytes, sizeof(bytes));
+				if (m_littleEndian)
+					return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+				else
+					return static_cast<uint16_t>(bytes[1] | (bytes[0] << 8));
+			}
+
+			uint32_t readUInt32() {
+				unsigned char bytes[4];
+				read(bytes, sizeof(bytes));
+				if (m_littleEndian)
+					return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+				else
+					return bytes[3] | (bytes[2] << 8) | (bytes[1] << 16) | (static_cast<uint32_t>(bytes[0]) << 24);
+			}
+
+			std::string readLine() {
+				std::string line;
+
+				for (;;) {
+					auto ch = readUInt8();
+					if (ch == '\n')
+						break;
+
+					if (line.size() >= 256)
+						throw std::runtime_error("not a NIF file: header string is too long");
+
+					line.push_back(static_cast<char>(ch));
+				}
+
+				return line;
+			}
+
+			std::string readSizedString() {
+				auto length = readUInt32();
+				if (length > 0x10000)
+					throw std::runtime_error("NIF header string is too long");
+
+				std::string string(length, '\0');
+				read(&string[0], length);
+				return string;
+			}
+
+			void skipSizedString() {
+				skip(readUInt32());
+			}
+
+			void skipExportString() {
+				skip(readUInt8());
+			}
+
+		private:
+			std::istream &m_stream;
+			bool m_littleEndian;
+		};
+
+		uint32_t parseVersionString(const std::string &headerString) {
+			if (headerString.compare(0, 22, "NetImmerse File Format") != 0 &&
+				headerString.compare(0, 20, "Gamebryo File Format") != 0)
+				throw std::runtime_error("not a NIF file: unrecognized header string");
+
+			auto versionPosition = headerString.find("Version ");
+			if (versionPosition == std::string::npos)
+				throw std::runtime_error("not a NIF file: no version in header string");
+
+			uint32_t version = 0;
+			unsigned int components = 0;
+			uint32_t component = 0;
+
+			for (auto it = headerString.begin() + versionPosition + 8; it != headerString.end() && components < 4; ++it) {
+				if (*it >= '0' && *it <= '9') {
+					component = component * 10 + (*it - '0');
+				}
+				else if (*it == '.') {
+					version = (version << 8) | (component & 0xFF);
+					component = 0;
+					components++;
+				}
+				else {
+					break;
+				}
+			}
+
+			while (components < 4) {
+				version = (version << 8) | (component & 0xFF);
+				component = 0;
+				components++;
+			}
+
+			return version;
+		}
+
+		bool typeKindOf(const std::string &typeName, const Symbol &base) {
+			for (Symbol type(typeName.c_str()); !type.isNull(); type = type.parentType()) {
+				if (type == base)
+					return true;
+			}
+
+			return false;
+		}
+
+		void classifyBlockTypes(NIF2FBXProbeResult &result) {
+			static const Symbol niAVObject("NiAVObject");
+			static const Symbol niSequence("NiSequence");
+			static const Symbol niGeometry("NiGeometry");
+			static const Symbol bsTriShape("BSTriShape");
+			static const Symbol bsGeometry("BSGeometry");
+			static const Symbol niSkinInstance("NiSkinInstance");
+			static const Symbol bsSkinInstance("BSSkin::Instance");
+
+			for (const auto &type : result.blockTypes) {
+				if (type.count == 0)
+					continue;
+
+				if (typeKindOf(type.name, niGeometry) || typeKindOf(type.name, bsTriShape) || typeKindOf(type.name, bsGeometry))
+					result.hasGeometry = true;
+
+				if (typeKindOf(type.name, niSkinInstance) || typeKindOf(type.name, bsSkinInstance))
+					result.hasSkinInstances = true;
+			}
+
+			if (!result.rootTypes.empty()) {
+				const auto &rootType = result.rootTypes.front();
+
+				if (typeKindOf(rootType, niAVObject))
+					result.rootKind = NIF2FBXProbeResult::RootKind::AVObject;
+				else if (typeKindOf(rootType, niSequence))
+					result.rootKind = NIF2FBXProbeResult::RootKind::Sequence;
+				else
+					result.rootKind = NIF2FBXProbeResult::RootKind::Other;
+			}
+		}
+	}
+
+	void probeNIF(std::istream &stream, NIF2FBXProbeResult &result) {
+		HeaderReader reader(stream);
+
+		result.headerString = reader.readLine();
+		result.version = parseVersionString(result.headerString);
+		result.userVersion = 0;
+		result.bethesdaVersion = 0;
+		result.blockCount = 0;
+		result.blockTypesKnown = false;
+		result.rootsKnown = false;
+		result.blockTypes.clear();
+		result.rootTypes.clear();
+		result.rootKind = NIF2FBXProbeResult::RootKind::Unknown;
+		result.hasGeometry = false;
+		result.hasSkinInstances = false;
+
+		if (result.version <= Version_3_1_0_0) {
+			for (unsigned int line = 0; line < 3; line++) {
+				reader.readLine();
+			}
+		}
+
+		if (result.version >= Version_3_1_0_1) {
+			auto binaryVersion = reader.readUInt32();
+			if (binaryVersion != result.version)
+				throw std::runtime_error("NIF header version mismatch");
+		}
+
+		if (result.version >= Version_20_0_0_3) {
+			reader.setLittleEndian(reader.readUInt8() != 0);
+		}
+
+		if (result.version >= Version_10_0_1_8) {
+			result.userVersion = reader.readUInt32();
+		}
+
+		if (result.version >= Version_3_1_0_1) {
+			result.blockCount = reader.readUInt32();
+		}
+
+		if (result.userVersion >= 3 &&
+			(result.version == Version_10_0_1_2 || result.version == Version_20_2_0_7 || result.version == Version_20_0_0_5 ||
+			(result.version >= Version_10_1_0_0 && result.version <= Version_20_0_0_4 && result.userVersion <= 11))) {
+
+			result.bethesdaVersion = reader.readUInt32();
+			reader.skipExportString(); // Author
+
+			if (result.bethesdaVersion > 130)
+				reader.readUInt32();
+			else
+				reader.skipExportString(); // Process Script
+
+			reader.skipExportString(); // Export Script
+
+			if (result.bethesdaVersion >= 103)
+				reader.skipExportString(); // Max Filepath
+		}
+
+		if (result.version >= Version_30_0_0_0) {
+			reader.skipSizedString(); // Metadata
+		}
+
+		if (result.version < Version_5_0_0_1) {
+			/*
+			 * No block type table: each block is prefixed by its type name,
+			 * so only the first one can be read without decoding blocks.
+			 * It is the root in all files seen in practice.
+			 */
+			auto typeName = reader.readSizedString();
+			if (typeName == "Top Level Object")
+				typeName = reader.readSizedString();
+
+			result.blockTypes.push_back(NIF2FBXProbeResult::BlockType{ typeName, 1 });
+			result.rootTypes.push_back(typeName);
+			classifyBlockTypes(result);
+			return;
+		}
+
+		auto typeCount = reader.readUInt16();
+		result.blockTypes.resize(typeCount);
+
+		for (auto &type : result.blockTypes) {
+			if (result.version >= Version_20_3_1_2) {
+				char hashName[16];
+				snprintf(hashName, sizeof(hashName), "0x%08X", reader.readUInt32());
+				type.name = hashName;
+			}
+			else {
+				type.name = reader.readSizedString();
+			}
+
+			type.count = 0;
+		}
+
+		std::vector<uint16_t> blockTypeIndices;
+		for (uint32_t block = 0; block < result.blockCount; block++) {
+			// The high bit marks PhysX blocks in 20.2.0.5 and later
+			auto typeIndex = static_cast<uint16_t>(reader.readUInt16() & 0x7FFF);
+			if (typeIndex >= typeCount)
+				throw std::runtime_error("NIF block type index is out of range");
+
+			result.blockTypes[typeIndex].count++;
+			blockTypeIndices.push_back(typeIndex);
+		}
+
+		result.blockTypesKnown = true;
+
+		if (result.version >= Version_20_2_0_5) {
+			uint64_t blockDataSize = 0;
+			for (uint32_t block = 0; block < result.blockCount; block++) {
+				blockDataSize += reader.readUInt32();
+			}
+
+			auto stringCount = reader.readUInt32();
+			reader.readUInt32(); // Max String Length
+			for (uint32_t string = 0; string < stringCount; string++) {
+				reader.skipSizedString();
+			}
+
+			auto groupCount = reader.readUInt32();
+			reader.skip(static_cast<uint64_t>(groupCount) * 4);
+
+			reader.skip(blockDataSize);
+
+			auto rootCount = reader.readUInt32();
+			for (uint32_t root = 0; root < rootCount; root++) {
+				auto index = static_cast<int32_t>(reader.readUInt32());
+				if (index >= 0 && static_cast<uint32_t>(index) < result.blockCount)
+					result.rootTypes.push_back(result.blockTypes[blockTypeIndices[index]].name);
+			}
+
+			result.rootsKnown = true;
+		}
+		else if (result.blockCount != 0) {
+			// Without block sizes the footer cannot be found; the first block is the root in practice.
+			result.rootTypes.push_back(result.blockTypes[blockTypeIndices.front()].name);
+		}
+
+		classifyBlockTypes(result);
+	}
+
+	void probeNIFFile(const char *filename, NIF2FBXProbeResult &result) {
+		std::ifstream stream;
+		stream.open(filename, std::ios::in | std::ios::binary);
+		if (!stream)
+			throw std::runtime_error(std::string("failed to open ") + filename);
+
+		probeNIF(stream, result);
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef NIF_PROBE_H
+#define NIF_PROBE_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <istream>
+
+#include <NIF2FBXProbe.h>
+
+namespace fbxnif {
+	/*
+	 * Fills result from the NIF header without decoding any blocks. Only the
+	 * footer is read past the header, and only when block sizes are known.
+	 * Throws std::runtime_error on truncated or non-NIF input.
+	 */
+	void probeNIF(std::istream &stream, NIF2FBXProbeResult &result);
+	void probeNIFFile(const char *filename, NIF2FBXProbeResult &result);
+}
+
+#endif
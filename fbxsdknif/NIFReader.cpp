@@ -3,6 +3,7 @@
 #include <fbxsdk/fbxsdk_def.h>
 #include <fbxsdk/fileio/fbximporter.h>
 #include <fbxsdk/core/base/fbxutils.h>
+#include <fbxsdk/core/fbxstream.h>
 
 #include <nifparse/NIFFile.h>
 
@@ -10,12 +11,15 @@
 
 #include "FBXSceneWriter.h"
 #include "SkeletonProcessor.h"
+#include "MemoryStreamBuffer.h"
+#include "FbxStreamBuffer.h"
+#include "TextureNameCache.h"
 
 namespace fbxnif {
 	const char *const NIFReader::m_extensions[]{ "nif", "kf", nullptr };
 	const char *const NIFReader::m_descriptions[]{ "Gamebryo model files (*.nif)", "Gamebryo animation files (*.kf)", nullptr };
 	
-	NIFReader::NIFReader(FbxManager &manager, int id) : FbxReader(manager, id, FbxStatusGlobal::GetRef()) {
+	NIFReader::NIFReader(FbxManager &manager, int id) : FbxReader(manager, id, FbxStatusGlobal::GetRef()), m_inputBuffer(nullptr), m_inputBufferSize(0), m_fbxStream(nullptr) {
 
 	}
 
@@ -76,10 +80,172 @@ namespace fbxnif {
 				"Pointer to NIF2FBXExtension (in integrated environments)",
 				&extensionDefault,
 				true);
+
+			int extensionVersionDefault = 1;
+			ios.AddProperty(
+				plugin,
+				"ExtensionVersion",
+				FbxIntDT,
+				"Interface version implemented by the extension (2 for NIF2FBXExtension2)",
+				&extensionVersionDefault,
+				true);
+
+			bool memoryMapDefault = true;
+			ios.AddProperty(
+				plugin,
+				"MemoryMap",
+				FbxBoolDT,
+				"Parse directly from a memory mapping of the file instead of a file stream",
+				&memoryMapDefault,
+				true);
+
+			unsigned long long inputBufferDefault = 0;
+			ios.AddProperty(
+				plugin,
+				"InputBuffer",
+				FbxULongLongDT,
+				"Pointer to in-memory NIF data to read instead of the file (in integrated environments)",
+				&inputBufferDefault,
+				true);
+
+			unsigned long long inputBufferSizeDefault = 0;
+			ios.AddProperty(
+				plugin,
+				"InputBufferSize",
+				FbxULongLongDT,
+				"Size of the in-memory NIF data, in bytes",
+				&inputBufferSizeDefault,
+				true);
+
+			FbxString archivesDefault = "";
+			ios.AddProperty(
+				plugin,
+				"Archives",
+				FbxStringDT,
+				"Semicolon-separated list of BSA/BA2 archives to read files and resolve textures from, highest priority first",
+				&archivesDefault,
+				true);
+
+			bool singlePassDefault = false;
+			ios.AddProperty(
+				plugin,
+				"SinglePass",
+				FbxBoolDT,
+				"Convert the scene in a single traversal instead of separate structural, geometry and animation passes",
+				&singlePassDefault,
+				true);
+
+			bool cacheTextureNamesDefault = false;
+			ios.AddProperty(
+				plugin,
+				"CacheTextureNames",
+				FbxBoolDT,
+				"Keep texture names translated by the extension for later imports using the same extension (see NIF2FBXExtension.h)",
+				&cacheTextureNamesDefault,
+				true);
+
+			unsigned long long textureNameCacheGenerationDefault = 0;
+			ios.AddProperty(
+				plugin,
+				"TextureNameCacheGeneration",
+				FbxULongLongDT,
+				"Change to discard texture names cached for the extension (e.g. when its asset mapping changes)",
+				&textureNameCacheGenerationDefault,
+				true);
 		}
 	}
 
+	/*
+	 * A caller-supplied buffer takes precedence over whatever file or stream
+	 * the importer was initialized with; the buffer must stay valid until
+	 * the import completes. The options are reset once taken, so that a
+	 * later import sharing the same IOSettings reads its own file.
+	 */
+	bool NIFReader::openInputBuffer() {
+		auto ios = GetIOSettings();
+		if (!ios)
+			return false;
+
+		auto bufferProperty = ios->GetProperty(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|InputBuffer");
+		auto sizeProperty = ios->GetProperty(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|InputBufferSize");
+		if (!bufferProperty.IsValid() || !sizeProperty.IsValid())
+			return false;
+
+		auto buffer = reinterpret_cast<const unsigned char *>(static_cast<uintptr_t>(bufferProperty.Get<unsigned long long>()));
+		if (!buffer)
+			return false;
+
+		m_inputBuffer = buffer;
+		m_inputBufferSize = static_cast<size_t>(sizeProperty.Get<unsigned long long>());
+
+		bufferProperty.Set(0ULL);
+		sizeProperty.Set(0ULL);
+
+		return true;
+	}
+
+	void NIFReader::configureArchives() {
+		auto ios = GetIOSettings();
+		if (!ios)
+			return;
+
+		m_archives.setArchives(static_cast<const char *>(ios->GetStringProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|Archives", "")));
+	}
+
+	/*
+	 * Archived entries are handed to the parser as an input buffer: in place
+	 * for stored entries, or decompressed into m_archiveStorage.
+	 */
+	bool NIFReader::openArchiveEntry(const char *fileName) {
+		ArchiveSet::Location location;
+		if (!m_archives.find(fileName, location))
+			return false;
+
+		auto contents = location.archive->read(*location.entry, m_archiveStorage);
+		m_inputBuffer = contents.first;
+		m_inputBufferSize = contents.second;
+
+		return true;
+	}
+
+	/*
+	 * Loose files take precedence over archived ones, so the archives are
+	 * only searched when nothing exists at the given path.
+	 */
 	bool NIFReader::FileOpen(char *pFileName) {
+		try {
+			configureArchives();
+		}
+		catch (const std::exception &e) {
+			GetStatus().SetCode(FbxStatus::eInvalidParameter, "failed to open archives: %s", e.what());
+			return false;
+		}
+
+		if (openInputBuffer())
+			return true;
+
+		if (GetFileAttributesA(pFileName) == INVALID_FILE_ATTRIBUTES) {
+			try {
+				if (openArchiveEntry(pFileName))
+					return true;
+			}
+			catch (const std::exception &e) {
+				GetStatus().SetCode(FbxStatus::eInvalidParameter, "failed to read %s from archives: %s", pFileName, e.what());
+				return false;
+			}
+		}
+
+		auto ios = GetIOSettings();
+		if (!ios || ios->GetBoolProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|MemoryMap", true)) {
+			try {
+				m_mappedFile.open(pFileName);
+				return true;
+			}
+			catch (const std::exception &e) {
+				fprintf(stderr, "NIFReader: failed to map %s, falling back to stream input: %s\n", pFileName, e.what());
+			}
+		}
+
 		try {
 			m_stream.exceptions(std::ios::failbit | std::ios::badbit | std::ios::eofbit);
 			m_stream.open(pFileName, std::ios::in | std::ios::binary);
@@ -92,7 +258,52 @@ namespace fbxnif {
 		}
 	}
 
+	bool NIFReader::FileOpen(FbxStream *pStream, void *pStreamData) {
+		try {
+			configureArchives();
+		}
+		catch (const std::exception &e) {
+			GetStatus().SetCode(FbxStatus::eInvalidParameter, "failed to open archives: %s", e.what());
+			return false;
+		}
+
+		if (openInputBuffer())
+			return true;
+
+		if (pStream->GetState() != FbxStream::eOpen && !pStream->Open(pStreamData)) {
+			GetStatus().SetCode(FbxStatus::eInvalidParameter, "failed to open stream");
+			return false;
+		}
+
+		m_fbxStream = pStream;
+		return true;
+	}
+
 	bool NIFReader::FileClose() {
+		if (m_inputBuffer) {
+			m_inputBuffer = nullptr;
+			m_inputBufferSize = 0;
+			std::vector<unsigned char>().swap(m_archiveStorage);
+			return true;
+		}
+
+		if (m_fbxStream) {
+			auto stream = m_fbxStream;
+			m_fbxStream = nullptr;
+
+			if (!stream->Close()) {
+				GetStatus().SetCode(FbxStatus::eInvalidParameter, "failed to close stream");
+				return false;
+			}
+
+			return true;
+		}
+
+		if (m_mappedFile.isOpen()) {
+			m_mappedFile.close();
+			return true;
+		}
+
 		try {
 			m_stream.close();
 			return true;
@@ -105,13 +316,35 @@ namespace fbxnif {
 	}
 
 	bool NIFReader::IsFileOpen() {
-		return m_stream.is_open();
+		return m_inputBuffer || m_fbxStream || m_mappedFile.isOpen() || m_stream.is_open();
+	}
+
+	void NIFReader::parseInput(NIFFile &file) {
+		if (m_inputBuffer || m_mappedFile.isOpen()) {
+			MemoryStreamBuffer buffer(
+				m_inputBuffer ? m_inputBuffer : m_mappedFile.data(),
+				m_inputBuffer ? m_inputBufferSize : m_mappedFile.size());
+
+			std::istream stream(&buffer);
+			stream.exceptions(std::ios::failbit | std::ios::badbit | std::ios::eofbit);
+			file.parse(stream);
+		}
+		else if (m_fbxStream) {
+			FbxStreamBuffer buffer(m_fbxStream);
+
+			std::istream stream(&buffer);
+			stream.exceptions(std::ios::failbit | std::ios::badbit | std::ios::eofbit);
+			file.parse(stream);
+		}
+		else {
+			file.parse(m_stream);
+		}
 	}
 
 	bool NIFReader::Read(FbxDocument *document) {
 		//try {
 			NIFFile file;
-			file.parse(m_stream);
+			parseInput(file);
 
 			SkeletonProcessor skeletonProcessor;
 
@@ -130,12 +363,31 @@ namespace fbxnif {
 					writer.setSkeletonFile(skeletonFile);
 				}
 
+				writer.setSinglePass(ios->GetBoolProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|SinglePass", false));
+
 				auto extensionProperty = ios->GetProperty(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|Extension");
 				if (extensionProperty.IsValid()) {
 					writer.setExtension(reinterpret_cast<NIF2FBXExtension *>(static_cast<uintptr_t>(extensionProperty.Get<unsigned long long>())));
+					writer.setExtensionVersion(ios->GetIntProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|ExtensionVersion", 1));
+
+					if (writer.extension()) {
+						if (ios->GetBoolProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|CacheTextureNames", false)) {
+							auto generationProperty = ios->GetProperty(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|TextureNameCacheGeneration");
+							auto generation = generationProperty.IsValid() ? generationProperty.Get<unsigned long long>() : 0ULL;
+
+							writer.setTextureNameCache(TextureNameCache::get(writer.extension(), m_archives.list(), generation));
+						}
+						else {
+							TextureNameCache::invalidate(writer.extension());
+						}
+					}
 				}
 			}
 
+			if (!m_archives.empty()) {
+				writer.setAssetSource(&m_archives);
+			}
+
 			writer.write(document);
 
 			return true;
@@ -150,4 +402,8 @@ namespace fbxnif {
 	bool NIFReader::GetReadOptions(bool pParseFileAsNeeded) {
 		return false;
 	}
+
+	bool NIFReader::SupportsStreams() const {
+		return true;
+	}
 }
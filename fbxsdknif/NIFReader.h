@@ -7,6 +7,13 @@
 
 #include <fstream>
 
+#include "MemoryMappedFile.h"
+#include "ArchiveSet.h"
+
+namespace nifparse {
+	class NIFFile;
+}
+
 namespace fbxnif {
 	class NIFReader final : public FbxReader {
 	public:
@@ -18,16 +25,29 @@ namespace fbxnif {
 		static void IOSettingsFiller(FbxIOSettings &ios);
 
 		virtual bool FileOpen(char *pFileName) override;
+		virtual bool FileOpen(FbxStream *pStream, void *pStreamData) override;
 		virtual bool FileClose() override;
 		virtual bool IsFileOpen() override;
 		virtual bool Read(FbxDocument *pDocument) override;
 		virtual bool GetReadOptions(bool pParseFileAsNeeded = true) override;
+		virtual bool SupportsStreams() const override;
 
 	private:
+		bool openInputBuffer();
+		void configureArchives();
+		bool openArchiveEntry(const char *fileName);
+		void parseInput(NIFFile &file);
+
 		static const char *const m_extensions[];
 		static const char *const m_descriptions[];
 
 		std::fstream m_stream;
+		MemoryMappedFile m_mappedFile;
+		const unsigned char *m_inputBuffer;
+		size_t m_inputBufferSize;
+		FbxStream *m_fbxStream;
+		ArchiveSet m_archives;
+		std::vector<unsigned char> m_archiveStorage;
 	};
 }
 
@@ -0,0 +1,88 @@
+#include "NIFSymbols.h"
+
+namespace fbxnif {
+	NIFSymbols::NIFSymbols() :
+		x("x"), y("y"), z("z"), w("w"),
+		u("u"), v("v"),
+		r("r"), g("g"), b("b"), a("a"),
+
+		m11("m11"), m12("m12"), m13("m13"),
+		m21("m21"), m22("m22"), m23("m23"),
+		m31("m31"), m32("m32"), m33("m33"),
+
+		v1("v1"), v2("v2"), v3("v3"),
+
+		string("String"),
+		index("Index"),
+		value("Value"),
+		strings("Strings"),
+		palette("Palette"),
+
+		name("Name"),
+		flags("Flags"),
+		translation("Translation"),
+		rotation("Rotation"),
+		scale("Scale"),
+		trsValid("TRS Valid"),
+		controller("Controller"),
+		nextController("Next Controller"),
+		properties("Properties"),
+		children("Children"),
+
+		numVertices("Num Vertices"),
+		vertexData("Vertex Data"),
+		vertex("Vertex"),
+		uv("UV"),
+		normal("Normal"),
+		tangent("Tangent"),
+		bitangentX("Bitangent X"),
+		bitangentY("Bitangent Y"),
+		bitangentZ("Bitangent Z"),
+		vertexColors("Vertex Colors"),
+
+		uvsAttribute("UVs"),
+		normalsAttribute("Normals"),
+		tangentsAttribute("Tangents"),
+		vertexColorsAttribute("Vertex_Colors"),
+
+		numKeys("Num Keys"),
+		interpolation("Interpolation"),
+		keys("Keys"),
+		time("Time"),
+		tbc("TBC"),
+		t("t"),
+		c("c"),
+		forward("Forward"),
+		backward("Backward"),
+
+		tbcKey("TBC_KEY"),
+		quadraticKey("QUADRATIC_KEY"),
+		xyzRotationKey("XYZ_ROTATION_KEY"),
+
+		niAVObject("NiAVObject"),
+		niNode("NiNode"),
+		niGeometry("NiGeometry"),
+		niTriBasedGeom("NiTriBasedGeom"),
+		niTriShapeData("NiTriShapeData"),
+		niTriStripsData("NiTriStripsData"),
+		bsTriShape("BSTriShape"),
+		rootCollisionNode("RootCollisionNode"),
+		niSequence("NiSequence"),
+		niKeyframeController("NiKeyframeController"),
+		niMultiTargetTransformController("NiMultiTargetTransformController"),
+		niControllerManager("NiControllerManager"),
+		niGeomMorpherController("NiGeomMorpherController"),
+		niTransformInterpolator("NiTransformInterpolator"),
+		niBSplineInterpolator("NiBSplineInterpolator"),
+		niMaterialProperty("NiMaterialProperty"),
+		niTexturingProperty("NiTexturingProperty"),
+		niAlphaProperty("NiAlphaProperty"),
+		niVertexColorProperty("NiVertexColorProperty") {
+
+	}
+
+	const NIFSymbols &symbols() {
+		static const NIFSymbols instance;
+		return instance;
+	}
+}
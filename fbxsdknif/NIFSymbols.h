@@ -0,0 +1,110 @@
+#ifndef NIF_SYMBOLS_H
+#define NIF_SYMBOLS_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <nifparse/Symbol.h>
+
+namespace fbxnif {
+	/*
+	 * Field, type and enumeration names used on hot paths, interned once per
+	 * process so that lookups do not construct a Symbol from a string literal.
+	 */
+	struct NIFSymbols {
+		NIFSymbols();
+
+		NIFSymbols(const NIFSymbols &other) = delete;
+		NIFSymbols &operator =(const NIFSymbols &other) = delete;
+
+		// Vector, color and texture coordinate components
+		const Symbol x, y, z, w;
+		const Symbol u, v;
+		const Symbol r, g, b, a;
+
+		// Matrix33
+		const Symbol m11, m12, m13;
+		const Symbol m21, m22, m23;
+		const Symbol m31, m32, m33;
+
+		// Triangle
+		const Symbol v1, v2, v3;
+
+		// Strings
+		const Symbol string;
+		const Symbol index;
+		const Symbol value;
+		const Symbol strings;
+		const Symbol palette;
+
+		// NiAVObject and transforms
+		const Symbol name;
+		const Symbol flags;
+		const Symbol translation;
+		const Symbol rotation;
+		const Symbol scale;
+		const Symbol trsValid;
+		const Symbol controller;
+		const Symbol nextController;
+		const Symbol properties;
+		const Symbol children;
+
+		// BSTriShape vertex data
+		const Symbol numVertices;
+		const Symbol vertexData;
+		const Symbol vertex;
+		const Symbol uv;
+		const Symbol normal;
+		const Symbol tangent;
+		const Symbol bitangentX;
+		const Symbol bitangentY;
+		const Symbol bitangentZ;
+		const Symbol vertexColors;
+
+		// VertexAttribute values
+		const Symbol uvsAttribute;
+		const Symbol normalsAttribute;
+		const Symbol tangentsAttribute;
+		const Symbol vertexColorsAttribute;
+
+		// Animation keys
+		const Symbol numKeys;
+		const Symbol interpolation;
+		const Symbol keys;
+		const Symbol time;
+		const Symbol tbc;
+		const Symbol t;
+		const Symbol c;
+		const Symbol forward;
+		const Symbol backward;
+
+		// KeyType and rotation type values
+		const Symbol tbcKey;
+		const Symbol quadraticKey;
+		const Symbol xyzRotationKey;
+
+		// Block types
+		const Symbol niAVObject;
+		const Symbol niNode;
+		const Symbol niGeometry;
+		const Symbol niTriBasedGeom;
+		const Symbol niTriShapeData;
+		const Symbol niTriStripsData;
+		const Symbol bsTriShape;
+		const Symbol rootCollisionNode;
+		const Symbol niSequence;
+		const Symbol niKeyframeController;
+		const Symbol niMultiTargetTransformController;
+		const Symbol niControllerManager;
+		const Symbol niGeomMorpherController;
+		const Symbol niTransformInterpolator;
+		const Symbol niBSplineInterpolator;
+		const Symbol niMaterialProperty;
+		const Symbol niTexturingProperty;
+		const Symbol niAlphaProperty;
+		const Symbol niVertexColorProperty;
+	};
+
+	const NIFSymbols &symbols();
+}
+
+#endif
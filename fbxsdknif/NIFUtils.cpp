@@ -1,114 +1,238 @@
 #include "NIFUtils.h"
+#include "NIFSymbols.h"
 
 #include <fbxsdk/core/math/fbxquaternion.h>
 
+#include <algorithm>
+
 namespace fbxnif {
 	std::string getString(const NIFDictionary &dict, const NIFDictionary &header)  {
-		Symbol string("String");
+		const auto &sym = symbols();
 
-		if (dict.data.count(string) == 0) {
-			auto index = static_cast<int32_t>(dict.getValue<uint32_t>("Index"));
+		auto string = findValue<NIFDictionary>(dict, sym.string);
+		if (!string) {
+			auto index = static_cast<int32_t>(dict.getValue<uint32_t>(sym.index));
 
 			if (index < 0)
 				return std::string();
 
-			const auto &strings = header.getValue<NIFArray>("Strings");
+			const auto &strings = header.getValue<NIFArray>(sym.strings);
 			if (index >= strings.data.size())
 				throw std::logic_error("string index is out of range");
 
-			return std::get<NIFDictionary>(strings.data[index]).getValue<std::string>("Value");
+			return std::get<NIFDictionary>(strings.data[index]).getValue<std::string>(sym.value);
 		}
 		else {
-			return dict.getValue<NIFDictionary>(string).getValue<std::string>("Value");
+			return string->getValue<std::string>(sym.value);
 		}
 	}
 
 	FbxVector4 getVector3(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxVector4(
-			dict.getValue<float>("x"),
-			dict.getValue<float>("y"),
-			dict.getValue<float>("z")
+			dict.getValue<float>(sym.x),
+			dict.getValue<float>(sym.y),
+			dict.getValue<float>(sym.z)
 		);
 	}
 
 	FbxVector4 getByteVector3(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxVector4(
-			getSignedFloatFromU8(dict.getValue<uint32_t>("x")),
-			getSignedFloatFromU8(dict.getValue<uint32_t>("y")),
-			getSignedFloatFromU8(dict.getValue<uint32_t>("z"))
+			getSignedFloatFromU8(dict.getValue<uint32_t>(sym.x)),
+			getSignedFloatFromU8(dict.getValue<uint32_t>(sym.y)),
+			getSignedFloatFromU8(dict.getValue<uint32_t>(sym.z))
 		);
 	}
 
 	FbxVector4 getMatrix2x2(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxVector4(
-			dict.getValue<float>("m11"),
-			dict.getValue<float>("m21"),
-			dict.getValue<float>("m12"),
-			dict.getValue<float>("m22")
+			dict.getValue<float>(sym.m11),
+			dict.getValue<float>(sym.m21),
+			dict.getValue<float>(sym.m12),
+			dict.getValue<float>(sym.m22)
 		);
 	}
 
 	FbxAMatrix getMatrix3x3(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		FbxAMatrix mat;
 
 		auto dat = static_cast<double *>(mat);
 
-		dat[0] = dict.getValue<float>("m11");
-		dat[1] = dict.getValue<float>("m12");
-		dat[2] = dict.getValue<float>("m13");
+		dat[0] = dict.getValue<float>(sym.m11);
+		dat[1] = dict.getValue<float>(sym.m12);
+		dat[2] = dict.getValue<float>(sym.m13);
 
-		dat[4] = dict.getValue<float>("m21");
-		dat[5] = dict.getValue<float>("m22");
-		dat[6] = dict.getValue<float>("m23");
+		dat[4] = dict.getValue<float>(sym.m21);
+		dat[5] = dict.getValue<float>(sym.m22);
+		dat[6] = dict.getValue<float>(sym.m23);
 
-		dat[8] = dict.getValue<float>("m31");
-		dat[9] = dict.getValue<float>("m32");
-		dat[10] = dict.getValue<float>("m33");
+		dat[8] = dict.getValue<float>(sym.m31);
+		dat[9] = dict.getValue<float>(sym.m32);
+		dat[10] = dict.getValue<float>(sym.m33);
 
 		return mat;
 	}
 
 	FbxDouble3 getColor3(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxDouble3(
-			dict.getValue<float>("r"),
-			dict.getValue<float>("g"),
-			dict.getValue<float>("b")
+			dict.getValue<float>(sym.r),
+			dict.getValue<float>(sym.g),
+			dict.getValue<float>(sym.b)
 		);
 	}
 
 	FbxColor getColor4(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxColor(
-			dict.getValue<float>("r"),
-			dict.getValue<float>("g"),
-			dict.getValue<float>("b"),
-			dict.getValue<float>("a")
+			dict.getValue<float>(sym.r),
+			dict.getValue<float>(sym.g),
+			dict.getValue<float>(sym.b),
+			dict.getValue<float>(sym.a)
 		);
 	}
 
 	FbxColor getByteColor4(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxColor(
-			getUnsignedFloatFromU8(dict.getValue<uint32_t>("r")),
-			getUnsignedFloatFromU8(dict.getValue<uint32_t>("g")),
-			getUnsignedFloatFromU8(dict.getValue<uint32_t>("b")),
-			getUnsignedFloatFromU8(dict.getValue<uint32_t>("a"))
+			getUnsignedFloatFromU8(dict.getValue<uint32_t>(sym.r)),
+			getUnsignedFloatFromU8(dict.getValue<uint32_t>(sym.g)),
+			getUnsignedFloatFromU8(dict.getValue<uint32_t>(sym.b)),
+			getUnsignedFloatFromU8(dict.getValue<uint32_t>(sym.a))
 		);
 	}
 
 	FbxVector2 getTexCoord(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxVector2(
-			dict.getValue<float>("u"),
-			dict.getValue<float>("v")
+			dict.getValue<float>(sym.u),
+			dict.getValue<float>(sym.v)
 		);
 	}
 
 	FbxAMatrix getTransform(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxAMatrix(
-			getVector3(dict.getValue<NIFDictionary>("Translation")),
-			getMatrix3x3(dict.getValue<NIFDictionary>("Rotation")).GetQ(),
-			FbxVector4(FbxDouble3(dict.getValue<float>("Scale")))
+			getVector3(dict.getValue<NIFDictionary>(sym.translation)),
+			getMatrix3x3(dict.getValue<NIFDictionary>(sym.rotation)).GetQ(),
+			FbxVector4(FbxDouble3(dict.getValue<float>(sym.scale)))
 		);
 	}
 
+	void getVector3Array(const NIFArray &array, std::vector<float> &values) {
+		const auto &sym = symbols();
+
+		values.resize(array.data.size() * 3);
+		auto out = values.data();
+
+		for (const auto &element : array.data) {
+			const auto &dict = std::get<NIFDictionary>(element);
+			*out++ = dict.getValue<float>(sym.x);
+			*out++ = dict.getValue<float>(sym.y);
+			*out++ = dict.getValue<float>(sym.z);
+		}
+	}
+
+	void getTexCoordArray(const NIFArray &array, std::vector<float> &values) {
+		const auto &sym = symbols();
+
+		values.resize(array.data.size() * 2);
+		auto out = values.data();
+
+		for (const auto &element : array.data) {
+			const auto &dict = std::get<NIFDictionary>(element);
+			*out++ = dict.getValue<float>(sym.u);
+			*out++ = dict.getValue<float>(sym.v);
+		}
+	}
+
+	void getColor4Array(const NIFArray &array, std::vector<float> &values) {
+		const auto &sym = symbols();
+
+		values.resize(array.data.size() * 4);
+		auto out = values.data();
+
+		for (const auto &element : array.data) {
+			const auto &dict = std::get<NIFDictionary>(element);
+			*out++ = dict.getValue<float>(sym.r);
+			*out++ = dict.getValue<float>(sym.g);
+			*out++ = dict.getValue<float>(sym.b);
+			*out++ = dict.getValue<float>(sym.a);
+		}
+	}
+
+	void getTriangleArray(const NIFArray &array, std::vector<uint32_t> &indices) {
+		const auto &sym = symbols();
+
+		indices.resize(array.data.size() * 3);
+		auto out = indices.data();
+
+		for (const auto &element : array.data) {
+			const auto &dict = std::get<NIFDictionary>(element);
+			*out++ = dict.getValue<uint32_t>(sym.v1);
+			*out++ = dict.getValue<uint32_t>(sym.v2);
+			*out++ = dict.getValue<uint32_t>(sym.v3);
+		}
+	}
+
+	void unstripTriangles(const NIFArray &stripLengths, const NIFArray &points, std::vector<uint32_t> &indices) {
+		size_t triangleCount = 0;
+		for (const auto &stripLength : stripLengths.data) {
+			auto length = std::get<uint32_t>(stripLength);
+			if (length > 2)
+				triangleCount += length - 2;
+		}
+
+		indices.resize(triangleCount * 3);
+		auto out = indices.data();
+
+		for (size_t stripIndex = 0, stripCount = std::min(stripLengths.data.size(), points.data.size()); stripIndex < stripCount; stripIndex++) {
+			const auto &stripPoints = std::get<NIFArray>(points.data[stripIndex]).data;
+			auto stripLength = std::min<size_t>(std::get<uint32_t>(stripLengths.data[stripIndex]), stripPoints.size());
+			if (stripLength < 3)
+				continue;
+
+			auto a = std::get<uint32_t>(stripPoints[0]);
+			auto b = std::get<uint32_t>(stripPoints[1]);
+
+			for (size_t stripPoint = 2; stripPoint < stripLength; stripPoint++) {
+				auto c = std::get<uint32_t>(stripPoints[stripPoint]);
+
+				if (a != b && b != c && a != c) {
+					if (stripPoint % 2) {
+						out[0] = c;
+						out[1] = b;
+						out[2] = a;
+					}
+					else {
+						out[0] = a;
+						out[1] = b;
+						out[2] = c;
+					}
+
+					out += 3;
+				}
+
+				a = b;
+				b = c;
+			}
+		}
+
+		indices.resize(out - indices.data());
+	}
+
 	NIFDictionary makeVector3(const FbxVector4 &vector) {
 		NIFDictionary dict;
 		dict.isNiObject = false;
@@ -156,33 +280,34 @@ namespace fbxnif {
 	}
 
 	FbxAMatrix getQuatTransform(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		FbxAMatrix transform;
 
 		bool tValid = true, rValid = true, sValid = true;
 
-		if (dict.data.count("TRS Valid") != 0) {
-			const auto &trs = dict.getValue<NIFArray>("TRS Valid");
-			tValid = std::get<uint32_t>(trs.data[0]) != 0;
-			rValid = std::get<uint32_t>(trs.data[1]) != 0;
-			sValid = std::get<uint32_t>(trs.data[2]) != 0;
+		if (auto trs = findValue<NIFArray>(dict, sym.trsValid)) {
+			tValid = std::get<uint32_t>(trs->data[0]) != 0;
+			rValid = std::get<uint32_t>(trs->data[1]) != 0;
+			sValid = std::get<uint32_t>(trs->data[2]) != 0;
 		}
 
 		if (tValid) {
-			auto translation = getVector3(dict.getValue<NIFDictionary>("Translation"));
+			auto translation = getVector3(dict.getValue<NIFDictionary>(sym.translation));
 			if (isOkayTransformValue(translation[0]) && isOkayTransformValue(translation[1]) && isOkayTransformValue(translation[2])) {
 				transform.SetT(translation);
 			}
 		}
 
 		if (rValid) {
-			auto rotation = getQuaternion(dict.getValue<NIFDictionary>("Rotation"));
+			auto rotation = getQuaternion(dict.getValue<NIFDictionary>(sym.rotation));
 			if (isOkayTransformValue(rotation[0]) && isOkayTransformValue(rotation[1]) && isOkayTransformValue(rotation[2]) && isOkayTransformValue(rotation[3])) {
 				transform.SetQ(rotation);
 			}
 		}
 
 		if (sValid) {
-			auto scale = dict.getValue<float>("Scale");
+			auto scale = dict.getValue<float>(sym.scale);
 			if (isOkayTransformValue(scale)) {
 				transform.SetS(FbxVector4(scale, scale, scale, 1.0f));
 			}
@@ -192,19 +317,21 @@ namespace fbxnif {
 	}
 
 	FbxQuaternion getQuaternion(const NIFDictionary &dict) {
+		const auto &sym = symbols();
+
 		return FbxQuaternion(
-			dict.getValue<float>("x"),
-			dict.getValue<float>("y"),
-			dict.getValue<float>("z"),
-			dict.getValue<float>("w")
+			dict.getValue<float>(sym.x),
+			dict.getValue<float>(sym.y),
+			dict.getValue<float>(sym.z),
+			dict.getValue<float>(sym.w)
 		);
 	}
 
-	std::string getStringFromPalette(uint32_t offset, const NIFDictionary &palette) {
-		const auto &string = palette.getValue<NIFDictionary>("Palette").getValue<NIFDictionary>("Palette").getValue<std::string>("Value");
+	std::string_view getStringFromPalette(uint32_t offset, const NIFDictionary &palette) {
+		const auto &sym = symbols();
 
-		auto stringEnd = string.find('\0', offset);
+		const auto &string = palette.getValue<NIFDictionary>(sym.palette).getValue<NIFDictionary>(sym.palette).getValue<std::string>(sym.value);
 
-		return string.substr(offset, stringEnd - offset);
+		return std::string_view(string).substr(offset, string.find('\0', offset) - offset);
 	}
 }
@@ -10,9 +10,31 @@
 #include <fbxsdk/core/math/fbxvector4.h>
 #include <fbxsdk/core/fbxpropertytypes.h>
 
+#include <vector>
+#include <string_view>
+
 namespace fbxnif {
+	/*
+	 * Optional field access with a single lookup. Returns nullptr if the
+	 * field is absent; a field of another type throws, as with getValue.
+	 */
+	template<typename T>
+	const T *findValue(const NIFDictionary &dict, const Symbol &name) {
+		auto it = dict.data.find(name);
+		if (it == dict.data.end())
+			return nullptr;
+
+		return &std::get<T>(it->second);
+	}
+
+	// True if the optional boolean field is present and set
+	static inline bool hasFlag(const NIFDictionary &dict, const Symbol &name) {
+		auto value = findValue<uint32_t>(dict, name);
+		return value && *value != 0;
+	}
+
 	std::string getString(const NIFDictionary &dict, const NIFDictionary &header);
-	std::string getStringFromPalette(uint32_t offset, const NIFDictionary &palette);
+	std::string_view getStringFromPalette(uint32_t offset, const NIFDictionary &palette);
 	FbxVector4 getVector3(const NIFDictionary &dict);
 	FbxVector4 getMatrix2x2(const NIFDictionary &dict);
 	FbxAMatrix getMatrix3x3(const NIFDictionary &dict);
@@ -25,6 +47,23 @@ namespace fbxnif {
 	FbxVector4 getByteVector3(const NIFDictionary &dict);
 	FbxQuaternion getQuaternion(const NIFDictionary &dict);
 
+	/*
+	 * Flatten arrays of Vector3, TexCoord, Color4 and Triangle structures
+	 * into contiguous component arrays (xyz, uv, rgba, v1 v2 v3), resolving
+	 * the field symbols once instead of once per element.
+	 */
+	void getVector3Array(const NIFArray &array, std::vector<float> &values);
+	void getTexCoordArray(const NIFArray &array, std::vector<float> &values);
+	void getColor4Array(const NIFArray &array, std::vector<float> &values);
+	void getTriangleArray(const NIFArray &array, std::vector<uint32_t> &indices);
+
+	/*
+	 * Converts triangle strips to a triangle list, keeping the alternating
+	 * winding of the strip and dropping the degenerate triangles that
+	 * stitch strips together.
+	 */
+	void unstripTriangles(const NIFArray &stripLengths, const NIFArray &points, std::vector<uint32_t> &indices);
+
 	NIFDictionary makeVector3(const FbxVector4 &vector);
 	NIFDictionary makeMatrix3x3(const FbxAMatrix &matrix);
 	NIFDictionary makeTransform(const FbxAMatrix &matrix);
@@ -5,6 +5,7 @@
 #include <algorithm>
 
 #include "NIFUtils.h"
+#include "NIFSymbols.h"
 
 #include <fbxsdk/core/math/fbxquaternion.h>
 
@@ -18,7 +19,7 @@ namespace fbxnif {
 		"NPC"
 	};
 
-	SkeletonProcessor::SkeletonProcessor() : m_cleaningRequired(false), m_skeletonImport(false) {
+	SkeletonProcessor::SkeletonProcessor() : m_commonBoneRoot(NoNode), m_cleaningRequired(false), m_skeletonImport(false) {
 
 	}
 
@@ -26,119 +27,217 @@ namespace fbxnif {
 
 	}
 
-	std::shared_ptr<NIFVariant> SkeletonProcessor::getParentOfNode(const std::shared_ptr<NIFVariant> &node) {
-		auto it = m_parentNodes.find(node);
-		if (it == m_parentNodes.end()) {
-			return {};
+	uint32_t SkeletonProcessor::nodeIndex(const NIFVariant *node) const {
+		auto it = m_nodeIndices.find(node);
+		if (it == m_nodeIndices.end()) {
+			return NoNode;
 		}
 
 		return it->second;
 	}
 
-	void SkeletonProcessor::process(NIFFile &file) {
-		m_file = &file;
+	uint32_t SkeletonProcessor::requireNodeIndex(const NIFVariant *node) const {
+		auto index = nodeIndex(node);
+		if (index == NoNode)
+			throw std::logic_error("node is not in the scene graph");
 
-		m_cleaningRequired = file.header().getValue<uint32_t>("Version") == 0x04000002; // Only Morrowind needs heavy-duty merging and cleaning
+		return index;
+	}
 
-		auto &roots = file.rootObjects().data;
-		if (roots.empty())
-			return;
+	uint32_t SkeletonProcessor::registerNode(const std::shared_ptr<NIFVariant> &node, uint32_t parentNode) {
+		auto result = m_nodeIndices.emplace(node.get(), static_cast<uint32_t>(m_nodes.size()));
+		if (result.second) {
+			m_nodes.emplace_back(node);
+			m_parents.emplace_back(parentNode);
+			m_boneFlags.emplace_back(false);
+		}
+		else if (m_parents[result.first->second] == NoNode) {
+			// Nodes referenced before the traversal reached them
+			m_parents[result.first->second] = parentNode;
+		}
 
-		auto &nifRoot = std::get<NIFReference>(roots.front());
+		return result.first->second;
+	}
+
+	std::vector<uint32_t> SkeletonProcessor::nodeDepths() const {
+		std::vector<uint32_t> depths(m_nodes.size(), NoNode);
+		std::vector<uint32_t> chain;
 
-		if (std::get<NIFDictionary>(*nifRoot.ptr).kindOf("NiAVObject")) {
-			collectSkinsAndParents(nifRoot, nullptr);
+		for (uint32_t index = 0, count = static_cast<uint32_t>(m_nodes.size()); index < count; index++) {
+			auto current = index;
+			while (current != NoNode && depths[current] == NoNode) {
+				chain.emplace_back(current);
+				current = m_parents[current];
+			}
+
+			auto depth = current == NoNode ? 0 : depths[current] + 1;
+			while (!chain.empty()) {
+				depths[chain.back()] = depth++;
+				chain.pop_back();
+			}
 		}
 
-		if (!m_skins.empty()) {
-			for (const auto &skinInfo : m_skins) {
-				const auto &skin = std::get<NIFDictionary>(*skinInfo.skin);
+		return depths;
+	}
 
-				for (const auto &bone : skin.getValue<NIFArray>("Bones").data) {
-					m_allBones.emplace(std::get<NIFPointer>(bone).ptr);
-				}
+	/*
+	 * Walks up from every node until reaching a node already seen, so every
+	 * node is visited at most once. Returns NoNode if the nodes are not all
+	 * in the same tree.
+	 */
+	uint32_t SkeletonProcessor::findCommonAncestor(const std::vector<uint32_t> &nodes) const {
+		auto depths = nodeDepths();
+		std::vector<bool> visited(m_nodes.size(), false);
+
+		auto ancestor = nodes.front();
+		for (auto current = ancestor; current != NoNode; current = m_parents[current]) {
+			visited[current] = true;
+		}
+
+		for (size_t index = 1, size = nodes.size(); index < size; index++) {
+			auto current = nodes[index];
+			while (current != NoNode && !visited[current]) {
+				visited[current] = true;
+				current = m_parents[current];
 			}
+
+			if (current == NoNode)
+				return NoNode;
+
+			if (depths[current] < depths[ancestor])
+				ancestor = current;
 		}
 
-		if(!m_allBones.empty()) {
-			bool needRecalculation;
-			do {
-				needRecalculation = false;
+		return ancestor;
+	}
 
-				std::vector<std::list<std::shared_ptr<NIFVariant>>> boneAncestors;
-				boneAncestors.reserve(m_allBones.size());
+	bool SkeletonProcessor::markBone(uint32_t index) {
+		if (m_boneFlags[index])
+			return false;
 
-				for (const auto &bone : m_allBones) {
-					std::list<std::shared_ptr<NIFVariant>> ancestors;
+		m_boneFlags[index] = true;
+		m_bones.emplace_back(index);
+		return true;
+	}
 
-					for (auto current = bone; current; current = getParentOfNode(current)) {
-						ancestors.push_front(current);
-					}
+	const SkeletonProcessor::SkinWeights *SkeletonProcessor::skinWeights(const NIFVariant *skinInstance) const {
+		auto it = m_skinIndices.find(skinInstance);
+		if (it == m_skinIndices.end()) {
+			return nullptr;
+		}
 
-					boneAncestors.emplace_back(std::move(ancestors));
-				}
+		return &m_skins[it->second].weights;
+	}
+
+	void SkeletonProcessor::decodeSkinWeights(SkinInfo &skinInfo) {
+		const auto &skin = std::get<NIFDictionary>(*skinInfo.skin);
+		auto &weights = skinInfo.weights;
 
-				if (boneAncestors.empty())
-					throw std::logic_error("skins are present, but not bones");
+		const auto &bones = skin.getValue<NIFArray>("Bones").data;
 
-				if (boneAncestors[0].empty())
-					throw std::logic_error("common bone ancestor cannot be determined");
+		for (const auto &bone : bones) {
+			auto bonePtr = std::get<NIFPointer>(bone).ptr.lock();
+			if (!bonePtr) {
+				weights.boneNodes.emplace_back(NoNode);
+				continue;
+			}
 
-				auto root = boneAncestors[0].front();
+			auto boneIndex = registerNode(bonePtr, NoNode);
+			weights.boneNodes.emplace_back(boneIndex);
+			markBone(boneIndex);
+		}
 
-				for (size_t index = 1, size = boneAncestors.size(); index < size; index++) {
-					if (boneAncestors[0].empty() || boneAncestors[0].front() != root)
-						throw std::logic_error("common bone ancestor cannot be determined");
-				}
+		const auto &skinDataPtr = skin.getValue<NIFReference>("Data").ptr;
+		if (!skinDataPtr)
+			throw std::logic_error("skin instance has no skin data");
 
-				for (auto &list : boneAncestors) {
-					list.pop_front();
-				}
+		const auto &boneList = std::get<NIFDictionary>(*skinDataPtr).getValue<NIFArray>("Bone List").data;
+		if (boneList.size() < bones.size())
+			throw std::logic_error("skin data has less bones than the skin instance");
 
-				while (!boneAncestors[0].empty()) {
-					auto firstAncestor = boneAncestors[0].front();
-					bool allSame = true;
+		Symbol symIndex("Index");
+		Symbol symWeight("Weight");
 
-					printf("Examining %s\n", nodeName(std::get<NIFDictionary>(*firstAncestor)).c_str());
+		size_t weightCount = 0;
+		for (size_t boneIndex = 0, boneCount = bones.size(); boneIndex < boneCount; boneIndex++) {
+			weightCount += std::get<NIFDictionary>(boneList[boneIndex]).getValue<NIFArray>("Vertex Weights").data.size();
+		}
 
-					for (size_t index = 1, size = boneAncestors.size(); index < size; index++) {
-						if (boneAncestors[index].empty() || boneAncestors[index].front() != firstAncestor) {
-							allSame = false;
-							break;
-						}
-					}
+		weights.skinTransforms.reserve(bones.size());
+		weights.weightOffsets.reserve(bones.size() + 1);
+		weights.vertices.reserve(weightCount);
+		weights.weights.reserve(weightCount);
 
-					if (allSame) {
-						root = firstAncestor;
+		weights.weightOffsets.emplace_back(0);
 
-						auto result = m_allBones.emplace(root);
-						if (result.second)
-							needRecalculation = true;
+		for (size_t boneIndex = 0, boneCount = bones.size(); boneIndex < boneCount; boneIndex++) {
+			const auto &boneData = std::get<NIFDictionary>(boneList[boneIndex]);
 
-						for (auto &list : boneAncestors) {
-							list.pop_front();
-						}
-					}
-					else {
-						break;
-					}
-				}
+			weights.skinTransforms.emplace_back(getTransform(boneData.getValue<NIFDictionary>("Skin Transform")));
 
-				auto result = m_allBones.emplace(root);
-				if (result.second)
-					needRecalculation = true;
+			for (const auto &weight : boneData.getValue<NIFArray>("Vertex Weights").data) {
+				const auto &weightDict = std::get<NIFDictionary>(weight);
 
-				m_commonBoneRoot = root;
+				weights.vertices.emplace_back(weightDict.getValue<uint32_t>(symIndex));
+				weights.weights.emplace_back(weightDict.getValue<float>(symWeight));
+			}
 
-				if (needRecalculation) {
-					printf("List of bones changed, rechecking root bone\n");
-				}
-			} while (needRecalculation);
+			weights.weightOffsets.emplace_back(weights.vertices.size());
+		}
+	}
+
+	void SkeletonProcessor::process(NIFFile &file) {
+		m_file = &file;
+
+		m_cleaningRequired = file.header().getValue<uint32_t>("Version") == 0x04000002; // Only Morrowind needs heavy-duty merging and cleaning
+
+		auto &roots = file.rootObjects().data;
+		if (roots.empty())
+			return;
+
+		auto &nifRoot = std::get<NIFReference>(roots.front());
+
+		if (std::get<NIFDictionary>(*nifRoot.ptr).kindOf(symbols().niAVObject)) {
+			collectSkinsAndParents(nifRoot, NoNode);
+		}
+
+		for (size_t skinIndex = 0, skinCount = m_skins.size(); skinIndex < skinCount; skinIndex++) {
+			auto &skinInfo = m_skins[skinIndex];
+
+			if (m_skinIndices.emplace(skinInfo.skin.get(), skinIndex).second) {
+				decodeSkinWeights(skinInfo);
+			}
+		}
+
+		if(!m_bones.empty()) {
+			auto commonAncestor = findCommonAncestor(m_bones);
+			if (commonAncestor == NoNode) {
+				fprintf(stderr, "bones do not share a common ancestor, using the root of the first bone\n");
+
+				commonAncestor = m_bones.front();
+				while (m_parents[commonAncestor] != NoNode)
+					commonAncestor = m_parents[commonAncestor];
+			}
+
+			printf("Common bone ancestor: %s\n", nodeName(std::get<NIFDictionary>(*m_nodes[commonAncestor])).c_str());
+
+			/*
+			 * The skeleton extends from the common ancestor up to, but not
+			 * including, the scene root.
+			 */
+			auto root = commonAncestor;
+			for (auto current = commonAncestor; m_parents[current] != NoNode; current = m_parents[current]) {
+				markBone(current);
+				root = current;
+			}
+
+			markBone(root);
+			m_commonBoneRoot = root;
 
 			if (m_cleaningRequired) {
-				auto skeletonParent = getParentOfNode(m_commonBoneRoot);
-				if (!skeletonParent) {
-					if (m_commonBoneRoot != nifRoot.ptr) {
+				auto skeletonParent = m_parents[m_commonBoneRoot];
+				if (skeletonParent == NoNode) {
+					if (m_nodes[m_commonBoneRoot] != nifRoot.ptr) {
 						throw std::logic_error("skeleton root has no parent, but is not the root node");
 					}
 
@@ -185,8 +284,7 @@ namespace fbxnif {
 
 					rootDict.data.emplace("Has Bounding Volume", 0U);
 
-					m_parentNodes.erase(m_commonBoneRoot);
-					m_parentNodes.emplace(m_commonBoneRoot, newRoot);
+					m_parents[m_commonBoneRoot] = registerNode(newRoot, NoNode);
 
 					/*
 					 * NiNode
@@ -204,11 +302,11 @@ namespace fbxnif {
 			}
 		}
 
-		if (!m_commonBoneRoot && m_skeletonImport) {
+		if (m_commonBoneRoot == NoNode && m_skeletonImport) {
 			fprintf(stderr, "Requested skeleton import, but no bones found on the first pass. Trying heuristics\n");
 
 			const auto &dict = std::get<NIFDictionary>(*std::get<NIFReference>(roots.front()).ptr);
-			if (!dict.kindOf("NiNode"))
+			if (!dict.kindOf(symbols().niNode))
 				throw std::runtime_error("Skeleton import is requested, but no NiNode at root level");
 
 			const auto &children = dict.getValue<NIFArray>("Children");
@@ -223,7 +321,7 @@ namespace fbxnif {
 					if (nodeName(childDict) == name) {
 						fprintf(stderr, "Found '%s'\n", name);
 
-						m_commonBoneRoot = ref.ptr;
+						m_commonBoneRoot = requireNodeIndex(ref.ptr.get());
 
 						markBones(ref);
 
@@ -235,32 +333,40 @@ namespace fbxnif {
 			
 		}
 
-		if (m_commonBoneRoot) {
-			printf("Skeleton root: %s\nNIF Root: %s\nAll bones, unordered:\n", nodeName(std::get<NIFDictionary>(*m_commonBoneRoot)).c_str(),
+		computeTransforms();
+
+		if (m_commonBoneRoot != NoNode) {
+			printf("Skeleton root: %s\nNIF Root: %s\nAll bones, unordered:\n", nodeName(std::get<NIFDictionary>(*m_nodes[m_commonBoneRoot])).c_str(),
 				nodeName(std::get<NIFDictionary>(*nifRoot.ptr)).c_str());
-			for (const auto &bone : m_allBones) {
-				printf(" - %s\n", nodeName(std::get<NIFDictionary>(*bone)).c_str());
+			for (auto bone : m_bones) {
+				printf(" - %s\n", nodeName(std::get<NIFDictionary>(*m_nodes[bone])).c_str());
 			}
 
-			if (m_cleaningRequired)
+			if (m_cleaningRequired) {
+				m_detachedFrom.assign(m_nodes.size(), NoNode);
+
 				processNode(nifRoot);
+				applyChildEdits();
+			}
 		}
 	}
 
 	void SkeletonProcessor::processNode(const NIFReference &node) {
 		const auto &dict = std::get<NIFDictionary>(*node.ptr);
-		if (dict.kindOf("NiNode")) {
-			if (m_commonBoneRoot == node.ptr) {
-				auto childrenCopy = dict.getValue<NIFArray>("Children").data;
-				for (const auto &child : childrenCopy) {
+		if (dict.kindOf(symbols().niNode)) {
+			/*
+			 * Children arrays are only edited by applyChildEdits, so they
+			 * can be iterated in place.
+			 */
+			if (m_nodes[m_commonBoneRoot] == node.ptr) {
+				for (const auto &child : dict.getValue<NIFArray>("Children").data) {
 					const auto &childDesc = std::get<NIFReference>(child);
 					if (childDesc.ptr)
 						processNodeInSkeleton(childDesc);
 				}
 			}
 			else {
-				auto childrenCopy = dict.getValue<NIFArray>("Children");
-				for (const auto &child : childrenCopy.data) {
+				for (const auto &child : dict.getValue<NIFArray>("Children").data) {
 					const auto &childDesc = std::get<NIFReference>(child);
 					if (childDesc.ptr)
 						processNode(childDesc);
@@ -269,54 +375,48 @@ namespace fbxnif {
 		}
 	}
 
-	void SkeletonProcessor::processNodeInSkeleton(const NIFReference &node) {
+	bool SkeletonProcessor::processNodeInSkeleton(const NIFReference &node) {
 		auto &dict = std::get<NIFDictionary>(*node.ptr);
-		if (dict.kindOf("NiNode")) {
-			NIFArray childrenCopy = dict.getValue<NIFArray>("Children");
-			for (const auto &child : childrenCopy.data) {
+		auto index = requireNodeIndex(node.ptr.get());
+
+		if (dict.kindOf(symbols().niNode)) {
+			const auto &children = dict.getValue<NIFArray>("Children").data;
+			size_t detachedChildren = 0;
+
+			for (const auto &child : children) {
 				const auto &childDesc = std::get<NIFReference>(child);
-				if (childDesc.ptr)
-					processNodeInSkeleton(childDesc);
+				if (childDesc.ptr && processNodeInSkeleton(childDesc))
+					detachedChildren++;
 			}
 
-			if (node.ptr != m_commonBoneRoot &&
-				m_allBones.count(node.ptr) == 0 &&
-				dict.getValue<NIFArray>("Children").data.empty()) {
+			if (index != m_commonBoneRoot &&
+				!m_boneFlags[index] &&
+				detachedChildren == children.size()) {
 
 				fprintf(stderr, "node %s no longer has any children\n", nodeName(dict).c_str());
 
-				auto parent = getParentOfNode(node.ptr);
-				auto &parentChildren = std::get<NIFDictionary>(*parent).getValue<NIFArray>("Children").data;
-				parentChildren.erase(std::remove_if(parentChildren.begin(), parentChildren.end(), [&node](const NIFVariant &ref) {
-					return std::get<NIFReference>(ref).ptr == node.ptr;
-				}), parentChildren.end());
+				detachChild(index);
+				return true;
 			}
 		}
-		else if (dict.kindOf("NiGeometry")) {
+		else if (dict.kindOf(symbols().niGeometry)) {
 			fprintf(stderr, "geometry in skeleton: %s\n", nodeName(dict).c_str());
 
-			std::shared_ptr<NIFVariant> closestBone;
+			uint32_t closestBone = NoNode;
 
-			for (auto parent = getParentOfNode(node.ptr); parent; parent = getParentOfNode(parent)) {
-				if (m_allBones.count(parent) != 0) {
+			for (auto parent = m_parents[index]; parent != NoNode; parent = m_parents[parent]) {
+				if (m_boneFlags[parent]) {
 					closestBone = parent;
 					break;
 				}
 			}
 
-			auto target = getParentOfNode(m_commonBoneRoot);
-			fprintf(stderr, "closest bone: %s, target: %s\n", nodeName(std::get<NIFDictionary>(*closestBone)).c_str(), nodeName(std::get<NIFDictionary>(*target)).c_str());
+			auto target = m_parents[m_commonBoneRoot];
+			fprintf(stderr, "closest bone: %s, target: %s\n", nodeName(std::get<NIFDictionary>(*m_nodes[closestBone])).c_str(), nodeName(std::get<NIFDictionary>(*m_nodes[target])).c_str());
 
-			auto localTransform = getLocalTransform(dict);
-			auto skinTransform = localTransform;
-
-			for (auto parent = getParentOfNode(node.ptr); parent != target; parent = getParentOfNode(parent)) {
-				localTransform = getLocalTransform(std::get<NIFDictionary>(*parent)) * localTransform;
-			}
-
-			for (auto parent = getParentOfNode(node.ptr); parent != closestBone; parent = getParentOfNode(parent)) {
-				skinTransform = getLocalTransform(std::get<NIFDictionary>(*parent)) * skinTransform;
-			}
+			const auto &world = m_transforms[index].world;
+			auto localTransform = m_transforms[target].world.Inverse() * world;
+			auto skinTransform = m_transforms[closestBone].world.Inverse() * world;
 
 			dict.data.erase("Translation");
 			dict.data.emplace("Translation", makeVector3(localTransform.GetT()));
@@ -325,23 +425,14 @@ namespace fbxnif {
 			dict.data.erase("Scale");
 			dict.data.emplace("Scale", static_cast<float>(localTransform.GetS()[0]));
 			
-			auto parent = getParentOfNode(node.ptr);
-			auto &parentChildren = std::get<NIFDictionary>(*parent).getValue<NIFArray>("Children").data;
-			parentChildren.erase(std::remove_if(parentChildren.begin(), parentChildren.end(), [&node](const NIFVariant &ref) {
-				return std::get<NIFReference>(ref).ptr == node.ptr;
-			}), parentChildren.end());
-
-			std::get<NIFDictionary>(*target).getValue<NIFArray>("Children").data.emplace_back(node);
+			detachChild(index);
+			m_attachedChildren.emplace_back(target, node);
 
-			m_parentNodes.erase(node.ptr);
-			m_parentNodes.emplace(node.ptr, target);
+			m_parents[index] = target;
+			decodeLocalTransform(index);
 
 			Symbol symSkinInstance("Skin Instance");
-			if (dict.data.count(symSkinInstance) == 0) {
-				dict.data.emplace(symSkinInstance, NIFReference());
-			}
-
-			auto &skinPtr = dict.getValue<NIFReference>(symSkinInstance).ptr;
+			auto &skinPtr = std::get<NIFReference>(dict.data.try_emplace(symSkinInstance, NIFReference()).first->second).ptr;
 			if (!skinPtr) {
 				printf("Setting up skinning\n");
 
@@ -366,11 +457,11 @@ namespace fbxnif {
 				skin.data.emplace("Skin Partition", NIFReference());
 
 				NIFPointer rootReference;
-				rootReference.ptr = m_commonBoneRoot;
+				rootReference.ptr = m_nodes[m_commonBoneRoot];
 				skin.data.emplace("Skeleton Root", std::move(rootReference));
 
 				NIFPointer boneReference;
-				boneReference.ptr = closestBone;
+				boneReference.ptr = m_nodes[closestBone];
 				NIFArray boneReferences;
 				boneReferences.data.emplace_back(std::move(boneReference));
 				skin.data.emplace("Bones", std::move(boneReferences));
@@ -378,28 +469,23 @@ namespace fbxnif {
 				SkinInfo skinInfo;
 				skinInfo.geometry = node.ptr;
 				skinInfo.skin = newSkin;
+				skinInfo.weights.boneNodes.emplace_back(closestBone);
+				skinInfo.weights.skinTransforms.emplace_back(skinTransform);
+				skinInfo.weights.weightOffsets = { 0, 0 };
+				skinInfo.weights.rigid = true;
+				m_skinIndices.emplace(newSkin.get(), m_skins.size());
 				m_skins.emplace_back(std::move(skinInfo));
 
 				skinData.data.emplace("Skin Transform", makeTransform(FbxAMatrix()));
 
-				auto &geomData = std::get<NIFDictionary>(*dict.getValue<NIFReference>("Data").ptr);
-				auto numVertices = geomData.getValue<uint32_t>("Num Vertices");
-				NIFArray weights;
-				weights.data.reserve(numVertices);
-
-				for (size_t vertex = 0; vertex < numVertices; vertex++) {
-					NIFDictionary weight;
-					weight.isNiObject = false;
-					weight.typeChain.emplace_back("BoneVertData");
-					weight.data.emplace("Index", static_cast<uint32_t>(vertex));
-					weight.data.emplace("Weight", 1.0f);
-					weights.data.emplace_back(std::move(weight));
-				}
-
+				/*
+				 * The rigid binding is only kept in SkinWeights, so the bone
+				 * has no per-vertex weights here.
+				 */
 				NIFDictionary bone;
 				bone.isNiObject = false;
 				bone.typeChain.emplace_back("BoneData");
-				bone.data.emplace("Vertex Weights", std::move(weights));
+				bone.data.emplace("Vertex Weights", NIFArray());
 				bone.data.emplace("Skin Transform", makeTransform(FbxAMatrix(skinTransform)));
 
 				NIFArray bones;
@@ -407,16 +493,19 @@ namespace fbxnif {
 
 				skinData.data.emplace("Bone List", std::move(bones));
 			}
+
+			return true;
 		}
+
+		return false;
 	}
 
 	void SkeletonProcessor::markBones(const NIFReference &node) {
-		auto &dict = std::get<NIFDictionary>(*node.ptr);
-		if (dict.kindOf("NiNode")) {
-			m_allBones.emplace(node.ptr);
+		const auto &dict = std::get<NIFDictionary>(*node.ptr);
+		if (dict.kindOf(symbols().niNode)) {
+			markBone(requireNodeIndex(node.ptr.get()));
 
-			NIFArray childrenCopy = dict.getValue<NIFArray>("Children");
-			for (const auto &child : childrenCopy.data) {
+			for (const auto &child : dict.getValue<NIFArray>("Children").data) {
 				const auto &childDesc = std::get<NIFReference>(child);
 				if (childDesc.ptr)
 					markBones(childDesc);
@@ -424,26 +513,103 @@ namespace fbxnif {
 		}
 	}
 
-	FbxAMatrix SkeletonProcessor::getLocalTransform(const NIFDictionary &node) const {
-		return FbxAMatrix(
-			getVector3(node.getValue<NIFDictionary>("Translation")),
-			getMatrix3x3(node.getValue<NIFDictionary>("Rotation")).GetQ(),
-			FbxVector4(FbxDouble3(node.getValue<float>("Scale")))
-		);
+	void SkeletonProcessor::detachChild(uint32_t index) {
+		auto parent = m_parents[index];
+		if (m_detachedFrom[index] != NoNode)
+			return;
+
+		m_detachedFrom[index] = parent;
+
+		if (std::find(m_editedParents.begin(), m_editedParents.end(), parent) == m_editedParents.end())
+			m_editedParents.emplace_back(parent);
 	}
 
-	void SkeletonProcessor::collectSkinsAndParents(const NIFReference &node, const std::shared_ptr<NIFVariant> &parentNode) {
+	/*
+	 * Removes every detached child in one pass over each edited parent, then
+	 * appends the reparented ones to their new parents.
+	 */
+	void SkeletonProcessor::applyChildEdits() {
+		for (auto parent : m_editedParents) {
+			auto &children = std::get<NIFDictionary>(*m_nodes[parent]).getValue<NIFArray>("Children").data;
+
+			children.erase(std::remove_if(children.begin(), children.end(), [this, parent](const NIFVariant &child) {
+				const auto &ref = std::get<NIFReference>(child);
+				if (!ref.ptr)
+					return false;
+
+				auto index = nodeIndex(ref.ptr.get());
+				return index != NoNode && m_detachedFrom[index] == parent;
+			}), children.end());
+		}
+
+		for (auto &attachment : m_attachedChildren) {
+			std::get<NIFDictionary>(*m_nodes[attachment.first]).getValue<NIFArray>("Children").data.emplace_back(std::move(attachment.second));
+		}
+
+		m_detachedFrom.clear();
+		m_editedParents.clear();
+		m_attachedChildren.clear();
+	}
+
+	void SkeletonProcessor::computeTransforms() {
+		m_transforms.resize(m_nodes.size());
+
+		std::vector<bool> computed(m_nodes.size(), false);
+		std::vector<uint32_t> chain;
+
+		for (uint32_t index = 0, count = static_cast<uint32_t>(m_nodes.size()); index < count; index++) {
+			for (auto current = index; current != NoNode && !computed[current]; current = m_parents[current]) {
+				chain.emplace_back(current);
+			}
+
+			while (!chain.empty()) {
+				auto current = chain.back();
+				chain.pop_back();
+
+				decodeLocalTransform(current);
+
+				auto &transform = m_transforms[current];
+				auto parent = m_parents[current];
+				transform.world = parent == NoNode ? transform.local : m_transforms[parent].world * transform.local;
+
+				computed[current] = true;
+			}
+		}
+	}
+
+	void SkeletonProcessor::decodeLocalTransform(uint32_t index) {
+		const auto &sym = symbols();
+		const auto &node = std::get<NIFDictionary>(*m_nodes[index]);
+		auto &transform = m_transforms[index];
+
+		if (!node.kindOf(sym.niAVObject)) {
+			transform.translation = FbxVector4();
+			transform.rotation = FbxVector4();
+			transform.scaling = FbxVector4(1.0, 1.0, 1.0);
+			transform.local.SetIdentity();
+			return;
+		}
+
+		auto rotation = getMatrix3x3(node.getValue<NIFDictionary>(sym.rotation));
+
+		transform.translation = getVector3(node.getValue<NIFDictionary>(sym.translation));
+		transform.rotation = rotation.GetR();
+		transform.scaling = FbxVector4(FbxDouble3(node.getValue<float>(sym.scale)));
+		transform.local = FbxAMatrix(transform.translation, rotation.GetQ(), transform.scaling);
+	}
+
+	void SkeletonProcessor::collectSkinsAndParents(const NIFReference &node, uint32_t parentNode) {
 		auto &desc = std::get<NIFDictionary>(*node.ptr);
-		m_parentNodes.emplace(node.ptr, parentNode);
+		auto index = registerNode(node.ptr, parentNode);
 
 		for (auto controller = desc.getValue<NIFReference>("Controller").ptr; controller; controller = std::get<NIFDictionary>(*controller).getValue<NIFReference>("Next Controller").ptr) {
 			const auto &controllerDict = std::get<NIFDictionary>(*controller);
 			
-			if (controllerDict.kindOf("NiKeyframeController")) {
-				if (std::get<NIFDictionary>(*controller).data.count(Symbol("Data")) != 0) {
-					const auto& dataPtr = controllerDict.getValue<NIFReference>("Data").ptr;
+			if (controllerDict.kindOf(symbols().niKeyframeController)) {
+				if (auto dataRef = findValue<NIFReference>(controllerDict, "Data")) {
+					const auto& dataPtr = dataRef->ptr;
 					if (dataPtr) {
-						auto& keyfData = std::get<NIFDictionary>(*controllerDict.getValue<NIFReference>("Data").ptr);
+						auto& keyfData = std::get<NIFDictionary>(*dataPtr);
 
 						auto rotationKeys = keyfData.getValue<uint32_t>("Num Rotation Keys");
 						auto translationKeys = keyfData.getValue<NIFDictionary>("Translations").getValue<uint32_t>("Num Keys");
@@ -456,41 +622,40 @@ namespace fbxnif {
 
 						}
 						else {
-							m_allBones.emplace(node.ptr);
+							markBone(index);
 						}
 					}
 				}
 			}
-			else if (controllerDict.kindOf("NiMultiTargetTransformController")) {
-				m_allBones.emplace(node.ptr);
+			else if (controllerDict.kindOf(symbols().niMultiTargetTransformController)) {
+				markBone(index);
 
 				for (const auto &target : controllerDict.getValue<NIFArray>("Extra Targets").data) {
 					const auto &targetPtr = std::get<NIFPointer>(target);
 
-					std::shared_ptr<NIFVariant> targetVal(targetPtr.ptr);
+					auto targetVal = targetPtr.ptr.lock();
 					if(targetVal)
-						m_allBones.emplace(targetVal);
+						markBone(registerNode(targetVal, NoNode));
 				}
 
 			}
 		}
 
-		if (desc.kindOf("NiNode")) {
+		if (desc.kindOf(symbols().niNode)) {
 			for (const auto &child : desc.getValue<NIFArray>("Children").data) {
 				const auto &ref = std::get<NIFReference>(child);
 				if (ref.ptr) {
-					collectSkinsAndParents(ref, node.ptr);
+					collectSkinsAndParents(ref, index);
 				}
 			}
 		}
-		else if (desc.kindOf("NiGeometry")) {
+		else if (desc.kindOf(symbols().niGeometry)) {
 			Symbol symSkinInstance("Skin Instance");
-			if (desc.data.count(symSkinInstance) != 0) {
-				const auto &ref = desc.getValue<NIFReference>(symSkinInstance);
-				if (ref.ptr) {
+			if (auto ref = findValue<NIFReference>(desc, symSkinInstance)) {
+				if (ref->ptr) {
 					SkinInfo skin;
 					skin.geometry = node.ptr;
-					skin.skin = ref.ptr;
+					skin.skin = ref->ptr;
 					m_skins.emplace_back(std::move(skin));
 				}
 			}
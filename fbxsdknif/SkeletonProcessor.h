@@ -5,8 +5,8 @@
 
 #include <nifparse/Types.h>
 
-#include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 #include <fbxsdk/core/math/fbxaffinematrix.h>
 
@@ -23,35 +23,101 @@ namespace fbxnif {
 		SkeletonProcessor(const SkeletonProcessor &other) = delete;
 		SkeletonProcessor &operator =(const SkeletonProcessor &other) = delete;
 
+		enum : uint32_t {
+			NoNode = ~0U
+		};
+
 		void process(NIFFile &file);
 
-		inline const std::unordered_set<std::shared_ptr<NIFVariant>> &allBones() const { return m_allBones; }
-		inline const std::shared_ptr<NIFVariant> &commonBoneRoot() const { return m_commonBoneRoot; }
+		/*
+		 * Every scene graph node gets a dense index when it is first seen,
+		 * so that per-node state can be kept in flat arrays.
+		 */
+		uint32_t nodeIndex(const NIFVariant *node) const;
+		inline size_t nodeCount() const { return m_nodes.size(); }
+		inline const std::shared_ptr<NIFVariant> &node(uint32_t index) const { return m_nodes[index]; }
+		inline uint32_t parentIndex(uint32_t index) const { return m_parents[index]; }
+
+		inline bool isBone(uint32_t index) const { return m_boneFlags[index]; }
+		inline const std::vector<uint32_t> &bones() const { return m_bones; }
+
+		inline uint32_t commonBoneRootIndex() const { return m_commonBoneRoot; }
+		inline const std::shared_ptr<NIFVariant> &commonBoneRoot() const { return m_commonBoneRoot == NoNode ? m_noNode : m_nodes[m_commonBoneRoot]; }
+
+		struct NodeTransform {
+			FbxVector4 translation;
+			FbxVector4 rotation; // Euler angles
+			FbxVector4 scaling;
+			FbxAMatrix local;
+			FbxAMatrix world;
+		};
+
+		// Decoded once per node after the scene graph is final
+		inline const NodeTransform &nodeTransform(uint32_t index) const { return m_transforms[index]; }
+
+		/*
+		 * Skin weights decoded from NiSkinData, or synthesized for rigid
+		 * bindings. The weights of bone i are the entries of vertices and
+		 * weights in [weightOffsets[i], weightOffsets[i + 1]).
+		 */
+		struct SkinWeights {
+			std::vector<uint32_t> boneNodes; // NoNode for null bones
+			std::vector<FbxAMatrix> skinTransforms;
+			std::vector<size_t> weightOffsets;
+			std::vector<uint32_t> vertices;
+			std::vector<float> weights;
+			bool rigid; // single bone with weight 1 for every vertex, no per-vertex entries
+
+			SkinWeights() : rigid(false) {}
+		};
+
+		const SkinWeights *skinWeights(const NIFVariant *skinInstance) const;
 
 		inline bool skeletonImport() const { return m_skeletonImport; }
 		inline void setSkeletonImport(bool skeletonImport) { m_skeletonImport = skeletonImport; }
 
 	private:
-		void collectSkinsAndParents(const NIFReference &node, const std::shared_ptr<NIFVariant> &parentNode);
-		std::shared_ptr<NIFVariant> getParentOfNode(const std::shared_ptr<NIFVariant> &node);
+		void collectSkinsAndParents(const NIFReference &node, uint32_t parentNode);
+		uint32_t registerNode(const std::shared_ptr<NIFVariant> &node, uint32_t parentNode);
+		uint32_t requireNodeIndex(const NIFVariant *node) const;
+		bool markBone(uint32_t index);
+		std::vector<uint32_t> nodeDepths() const;
+		uint32_t findCommonAncestor(const std::vector<uint32_t> &nodes) const;
 		void processNode(const NIFReference &node);
-		void processNodeInSkeleton(const NIFReference &node);
+		bool processNodeInSkeleton(const NIFReference &node);
+		void detachChild(uint32_t index);
+		void applyChildEdits();
 		void markBones(const NIFReference &node);
 		
 		std::string nodeName(const NIFDictionary &node) const;
 
-		FbxAMatrix getLocalTransform(const NIFDictionary &node) const;
+		void computeTransforms();
+		void decodeLocalTransform(uint32_t index);
 
 		struct SkinInfo {
 			std::shared_ptr<NIFVariant> geometry;
 			std::shared_ptr<NIFVariant> skin;
+			SkinWeights weights;
 		};
 
+		void decodeSkinWeights(SkinInfo &skinInfo);
+
 		NIFFile *m_file;
 		std::vector<SkinInfo> m_skins;
-		std::unordered_map<std::shared_ptr<NIFVariant>, std::shared_ptr<NIFVariant>> m_parentNodes;
-		std::shared_ptr<NIFVariant> m_commonBoneRoot;
-		std::unordered_set<std::shared_ptr<NIFVariant>> m_allBones;
+		std::unordered_map<const NIFVariant *, size_t> m_skinIndices;
+		std::vector<std::shared_ptr<NIFVariant>> m_nodes;
+		std::vector<uint32_t> m_parents;
+		std::unordered_map<const NIFVariant *, uint32_t> m_nodeIndices;
+		uint32_t m_commonBoneRoot;
+		std::vector<bool> m_boneFlags;
+		std::vector<uint32_t> m_bones;
+		std::vector<NodeTransform> m_transforms;
+
+		// Deferred cleanup edits: parent each node is removed from, and nodes appended to new parents
+		std::vector<uint32_t> m_detachedFrom;
+		std::vector<uint32_t> m_editedParents;
+		std::vector<std::pair<uint32_t, NIFReference>> m_attachedChildren;
+		std::shared_ptr<NIFVariant> m_noNode;
 		bool m_cleaningRequired;
 		bool m_skeletonImport;
 
@@ -0,0 +1,64 @@
+#include "TextureNameCache.h"
+
+#include <map>
+
+namespace fbxnif {
+	namespace {
+		struct CacheEntry {
+			std::string archives;
+			unsigned long long generation;
+			std::shared_ptr<TextureNameCache> cache;
+		};
+
+		std::mutex cachesMutex;
+		std::map<const NIF2FBXExtension *, CacheEntry> caches;
+	}
+
+	TextureNameCache::TextureNameCache() = default;
+
+	TextureNameCache::~TextureNameCache() = default;
+
+	std::shared_ptr<TextureNameCache> TextureNameCache::get(const NIF2FBXExtension *extension, const std::string &archives, unsigned long long generation) {
+		std::unique_lock<std::mutex> locker(cachesMutex);
+
+		auto &entry = caches[extension];
+		if (!entry.cache || entry.archives != archives || entry.generation != generation) {
+			entry.archives = archives;
+			entry.generation = generation;
+			entry.cache = std::make_shared<TextureNameCache>();
+		}
+
+		return entry.cache;
+	}
+
+	void TextureNameCache::invalidate(const NIF2FBXExtension *extension) {
+		std::unique_lock<std::mutex> locker(cachesMutex);
+
+		caches.erase(extension);
+	}
+
+	void TextureNameCache::clear() {
+		std::unique_lock<std::mutex> locker(cachesMutex);
+
+		caches.clear();
+	}
+
+	bool TextureNameCache::find(const std::string &originalName, std::string &assetName, std::string &fileName) const {
+		std::unique_lock<std::mutex> locker(m_mutex);
+
+		auto it = m_translations.find(originalName);
+		if (it == m_translations.end())
+			return false;
+
+		assetName = it->second.assetName;
+		fileName = it->second.fileName;
+
+		return true;
+	}
+
+	void TextureNameCache::insert(const std::string &originalName, const std::string &assetName, const std::string &fileName) {
+		std::unique_lock<std::mutex> locker(m_mutex);
+
+		m_translations.emplace(originalName, Translation{ assetName, fileName });
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef TEXTURE_NAME_CACHE_H
+#define TEXTURE_NAME_CACHE_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class NIF2FBXExtension;
+
+namespace fbxnif {
+	/*
+	 * Texture names translated by a NIF2FBXExtension, kept between
+	 * conversions so that the same extension does not translate the same
+	 * name again. Each extension has at most one cache, which is replaced
+	 * when the archive list or the caller-supplied generation changes, and
+	 * all of them are dropped when the plugin terminates. Thread-safe.
+	 */
+	class TextureNameCache {
+	public:
+		TextureNameCache();
+		~TextureNameCache();
+
+		TextureNameCache(const TextureNameCache &other) = delete;
+		TextureNameCache &operator =(const TextureNameCache &other) = delete;
+
+		static std::shared_ptr<TextureNameCache> get(const NIF2FBXExtension *extension, const std::string &archives, unsigned long long generation);
+		static void invalidate(const NIF2FBXExtension *extension);
+		static void clear();
+
+		bool find(const std::string &originalName, std::string &assetName, std::string &fileName) const;
+		void insert(const std::string &originalName, const std::string &assetName, const std::string &fileName);
+
+	private:
+		struct Translation {
+			std::string assetName;
+			std::string fileName;
+		};
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<std::string, Translation> m_translations;
+	};
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef TYPE_DISPATCH_TABLE_H
+#define TYPE_DISPATCH_TABLE_H
+
+#include "FBXNIFPluginNS.h"
+
+#include <nifparse/Types.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace fbxnif {
+	/*
+	 * Maps block types to handlers. A handler registered with
+	 * includeSubclasses matches like kindOf, otherwise like isA; when several
+	 * match, the most recently registered one wins, so later registrations
+	 * can override built-in handlers for a subclass.
+	 *
+	 * The outcome is cached per concrete type (the front of typeChain), so
+	 * the type chain is only walked once for each distinct block type.
+	 */
+	template<typename Handler>
+	class TypeDispatchTable {
+	public:
+		TypeDispatchTable() = default;
+
+		TypeDispatchTable(const TypeDispatchTable &other) = delete;
+		TypeDispatchTable &operator =(const TypeDispatchTable &other) = delete;
+
+		void add(const Symbol &type, Handler handler, bool includeSubclasses = true) {
+			m_registrations.push_back(Registration{ type, std::move(handler), includeSubclasses });
+			m_resolved.clear();
+		}
+
+		const Handler *find(const NIFDictionary &dict) const {
+			const auto &concreteType = dict.typeChain.front();
+
+			auto it = m_resolved.find(concreteType);
+			if (it == m_resolved.end()) {
+				it = m_resolved.emplace(concreteType, resolve(dict)).first;
+			}
+
+			if (it->second < 0)
+				return nullptr;
+
+			return &m_registrations[it->second].handler;
+		}
+
+	private:
+		struct Registration {
+			Symbol type;
+			Handler handler;
+			bool includeSubclasses;
+		};
+
+		int resolve(const NIFDictionary &dict) const {
+			for (size_t index = m_registrations.size(); index > 0; index--) {
+				const auto &registration = m_registrations[index - 1];
+
+				if (registration.includeSubclasses ? dict.kindOf(registration.type) : dict.isA(registration.type))
+					return static_cast<int>(index - 1);
+			}
+
+			return -1;
+		}
+
+		std::vector<Registration> m_registrations;
+		mutable std::unordered_map<Symbol, int> m_resolved;
+	};
+}
+
+#endif
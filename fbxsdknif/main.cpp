@@ -3,6 +3,7 @@
 #include <fbxsdk/core/fbxplugincontainer.h>
 
 #include "FBXNIFPlugin.h"
+#include "NIFProbe.h"
 
 static fbxnif::FBXNIFPlugin *PluginInstance;
 
@@ -17,4 +18,15 @@ extern "C" {
 			container.Register(*PluginInstance);
 		}
 	}
+
+	FBXSDK_DLLEXPORT bool NIF2FBXProbeFile(const char *fileName, NIF2FBXProbeResult &result, std::string &error) {
+		try {
+			fbxnif::probeNIFFile(fileName, result);
+			return true;
+		}
+		catch (const std::exception &e) {
+			error = e.what();
+			return false;
+		}
+	}
 }
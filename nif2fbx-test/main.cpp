@@ -10,6 +10,7 @@
 #include <fbxsdk/scene/fbxscene.h>
 
 #include <functional>
+#include <chrono>
 
 bool convert(fbxsdk::FbxManager *manager, const char *from, const char *to, std::function<void(fbxsdk::FbxIOSettings *)> &&config) {
 
@@ -55,6 +56,41 @@ bool convert(fbxsdk::FbxManager *manager, const char *from, const char *to, std:
 	return true;
 }
 
+bool benchmarkImport(fbxsdk::FbxManager *manager, const char *from, unsigned int iterations) {
+	for (bool memoryMap : { false, true }) {
+		auto start = std::chrono::steady_clock::now();
+
+		for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+			auto ios = fbxsdk::FbxIOSettings::Create(manager, IOSROOT);
+			ios->SetBoolProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|MemoryMap", memoryMap);
+
+			auto importer = fbxsdk::FbxImporter::Create(manager, "");
+			auto status = importer->Initialize(from, -1, ios);
+			if (!status) {
+				fprintf(stderr, "FbxImporter::Initialize failed: %s\n", importer->GetStatus().GetErrorString());
+				return false;
+			}
+
+			auto scene = fbxsdk::FbxScene::Create(manager, "benchmarkScene");
+			status = importer->Import(scene);
+			if (!status) {
+				fprintf(stderr, "FbxImporter::Import failed: %s\n", importer->GetStatus().GetErrorString());
+				return false;
+			}
+
+			scene->Destroy();
+			importer->Destroy();
+			ios->Destroy();
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		printf("%s: %s input: %.3f ms per import over %u iterations\n", from, memoryMap ? "memory mapped" : "stream", elapsed.count() / iterations, iterations);
+	}
+
+	return true;
+}
+
 int main(int argc, char *argv[]) {
 	auto manager = fbxsdk::FbxManager::Create();
 	
@@ -71,6 +107,15 @@ int main(int argc, char *argv[]) {
 	auto lExtension = "so";
 #endif
 	manager->LoadPluginsDirectory(lPath.Buffer(), lExtension);
+
+	/*
+	// Stream vs. memory mapped input on large BSTriShape and NiTriShapeData meshes
+	if (!benchmarkImport(manager, "C:\\projects\\nifparse\\meshes\\sse\\alduin.nif", 20))
+		return 1;
+
+	if (!benchmarkImport(manager, "C:\\projects\\nifparse\\meshes\\oblivion\\meshes\\architecture\\imperialcity\\icmarketdistrict.nif", 20))
+		return 1;
+	*/
 	/*
 	if (!convert(manager, "C:\\projects\\nifparse\\meshes\\skeleton.nif", "C:\\projects\\nifparse\\meshes\\skeleton.fbx", [](fbxsdk::FbxIOSettings *ios) {
 		ios->SetBoolProp(IMP_FBX_EXT_SDK_GRP "|FBXSDKNIF|SkeletonImport", true);
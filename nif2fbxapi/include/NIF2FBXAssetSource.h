@@ -0,0 +1,25 @@
+#ifndef NIF2FBXASSETSOURCE_H
+#define NIF2FBXASSETSOURCE_H
+
+#include <string>
+#include <vector>
+
+/*
+ * Asset lookup against the archives configured for a conversion
+ * (FBXSDKNIF|Archives import option). Names are matched case-insensitively,
+ * with either path separator.
+ */
+class NIF2FBXAssetSource {
+protected:
+	inline NIF2FBXAssetSource() {}
+	inline ~NIF2FBXAssetSource() {}
+
+public:
+	NIF2FBXAssetSource(const NIF2FBXAssetSource& other) = delete;
+	NIF2FBXAssetSource &operator =(const NIF2FBXAssetSource& other) = delete;
+
+	virtual bool resolveAsset(const std::string& name, std::string& archiveName, std::string& entryName) const = 0;
+	virtual bool readAsset(const std::string& entryName, std::vector<unsigned char>& data) const = 0;
+};
+
+#endif
@@ -2,7 +2,20 @@
 #define NIF2FBXEXTENSION_H
 
 #include <string>
+#include <vector>
 
+class NIF2FBXAssetSource;
+
+/*
+ * With the CacheTextureNames import option enabled, the plugin keeps the
+ * names returned by an extension and reuses them in later imports given
+ * the same extension pointer, archive list and TextureNameCacheGeneration
+ * value. The pointer is the extension's only identity: a caller that
+ * destroys an extension must either disable the option or change the
+ * generation for later imports, since a new extension may be allocated at
+ * the same address. The same applies when an extension's translations
+ * change during its lifetime.
+ */
 class NIF2FBXExtension {
 protected:
 	inline NIF2FBXExtension() {}
@@ -15,4 +28,72 @@ public:
 	virtual void translateTextureAsset(const std::string& originalName, std::string& assetName, std::string& fileName) = 0;
 };
 
+/*
+ * Receives the results of NIF2FBXExtension2::translateTextureAssets. The
+ * methods may be called from any thread; textureAssetTranslationsComplete
+ * must be called exactly once, after the last textureAssetTranslated, and
+ * the object must not be used after it returns.
+ */
+class NIF2FBXTextureTranslationCallback {
+protected:
+	inline NIF2FBXTextureTranslationCallback() {}
+	inline ~NIF2FBXTextureTranslationCallback() {}
+
+public:
+	NIF2FBXTextureTranslationCallback(const NIF2FBXTextureTranslationCallback& other) = delete;
+	NIF2FBXTextureTranslationCallback &operator =(const NIF2FBXTextureTranslationCallback& other) = delete;
+
+	virtual void textureAssetTranslated(const std::string& originalName, const std::string& assetName, const std::string& fileName) = 0;
+	virtual void textureAssetTranslationsComplete() = 0;
+};
+
+/*
+ * The Extension import option still holds a NIF2FBXExtension pointer; an
+ * extension implementing this interface must also set the
+ * ExtensionVersion import option to NIF2FBXExtension2::Version. Without
+ * it the plugin only calls the NIF2FBXExtension methods, since extensions
+ * built against older headers do not have the slots added here.
+ */
+class NIF2FBXExtension2 : public NIF2FBXExtension {
+protected:
+	inline NIF2FBXExtension2() {}
+	inline ~NIF2FBXExtension2() {}
+
+public:
+	enum : int {
+		Version = 2
+	};
+
+	// Used instead of translateTextureAsset when the conversion has archives configured; assets may be null.
+	virtual void resolveTextureAsset(const std::string& originalName, const NIF2FBXAssetSource* assets, std::string& assetName, std::string& fileName) {
+		translateTextureAsset(originalName, assetName, fileName);
+	}
+
+	/*
+	 * Called at the start of a conversion with every texture name the scene
+	 * references; originalNames is only valid during the call. Results may
+	 * be delivered to callback later, from another thread. The conversion
+	 * waits for completion when the first texture is converted, and names
+	 * that were not delivered are translated one by one. assets is the
+	 * archive set if one is configured, null otherwise. The default
+	 * translates every name before returning.
+	 */
+	virtual void translateTextureAssets(const std::vector<std::string>& originalNames, const NIF2FBXAssetSource* assets, NIF2FBXTextureTranslationCallback* callback) {
+		for (const auto& originalName : originalNames) {
+			std::string assetName, fileName;
+
+			if (assets) {
+				resolveTextureAsset(originalName, assets, assetName, fileName);
+			}
+			else {
+				translateTextureAsset(originalName, assetName, fileName);
+			}
+
+			callback->textureAssetTranslated(originalName, assetName, fileName);
+		}
+
+		callback->textureAssetTranslationsComplete();
+	}
+};
+
 #endif
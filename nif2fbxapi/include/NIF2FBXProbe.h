@@ -0,0 +1,50 @@
+#ifndef NIF2FBXPROBE_H
+#define NIF2FBXPROBE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Summary of a NIF/KF file gathered from its header, block type table and
+ * block size table only, without decoding any blocks.
+ */
+struct NIF2FBXProbeResult {
+	enum class RootKind {
+		Unknown,
+		AVObject,		// NiAVObject subclass: scene graph (mesh or skeleton)
+		Sequence,		// NiSequence subclass: KF animation
+		Other
+	};
+
+	struct BlockType {
+		std::string name;
+		uint32_t count;
+	};
+
+	std::string headerString;
+	uint32_t version;
+	uint32_t userVersion;
+	uint32_t bethesdaVersion;
+	uint32_t blockCount;
+
+	// False for files older than 5.0.0.1, which have no block type table; only the first block's type is known then.
+	bool blockTypesKnown;
+
+	// True for 20.2.0.5 and later, where the root list in the footer can be located without decoding blocks.
+	bool rootsKnown;
+
+	std::vector<BlockType> blockTypes;
+	std::vector<std::string> rootTypes;
+	RootKind rootKind;
+	bool hasGeometry;
+	bool hasSkinInstances;
+};
+
+/*
+ * Exported by the plugin module as NIF2FBXProbeFile. Returns false and
+ * fills error if the file cannot be read or is not a NIF file.
+ */
+typedef bool (*NIF2FBXProbeFileFunction)(const char* fileName, NIF2FBXProbeResult& result, std::string& error);
+
+#endif